@@ -25,6 +25,9 @@ const padInputFields = [
 	"pad-scan-time",
 	"pad-mask-time",
 	"pad-retrigger-time",
+	"pad-predict-time",
+	"pad-gate-time",
+	"pad-position-control",
 	"pad-head-threshold",
 	"pad-head-sensitivity",
 	"pad-rim-threshold",
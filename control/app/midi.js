@@ -26,6 +26,7 @@ const MIDI_OSCILLOSCOPE_REQUEST = 12;
 const MIDI_OSCILLOSCOPE_START = 13;
 const MIDI_OSCILLOSCOPE_DATA = 14;
 const MIDI_OSCILLOSCOPE_END = 15;
+const MIDI_UPDATE_CROSSTALK = 16;
 
 
 //
@@ -75,6 +76,9 @@ const midiPropertiesLayout = {
 	scanTime: "b",
 	maskTime: "b",
 	retriggerTime: "b",
+	predictTime: "b",
+	gateTime: "b",
+	positionControl: "b",
 	curve: "b",
 
 	headSensor: "b",
@@ -97,6 +101,7 @@ const midiMonitorStartLayout = {
 	pad: "b",
 	channel: "b",
 	size: "w",
+	pretrigger: "w",
 	end: "e"
 };
 
@@ -126,6 +131,7 @@ const midiOscilloscopeStartLayout = {
 	command: "b",
 	probe: "b",
 	size: "w",
+	pretrigger: "w",
 	end: "e"
 };
 
@@ -11,6 +11,7 @@
 
 const MONITOR_HSCALE = 50;
 const MONITOR_VSCALE = 128;
+const MONITOR_PRETRIGGER = 2;
 
 
 //
@@ -23,7 +24,8 @@ class Monitor {
 		this.visible = false;
 		this.values = [[], [], []];
 		this.colors = ["#00f", "#0f0", "#f00"];
-		this.hscale = new Scale(0, MONITOR_HSCALE);
+		this.hscale = new Scale(-MONITOR_PRETRIGGER, MONITOR_HSCALE);
+		this.pretrigger = 0;
 
 		// track element and graphical context
 		this.element = document.getElementById("monitor");
@@ -100,7 +102,9 @@ class Monitor {
 			MIDI_VENDOR_ID, [
 				MIDI_MONITOR_REQUEST,
 				this.visible ? 1 : 0,
-				this.pad.id]);
+				this.pad.id,
+				(MONITOR_PRETRIGGER * this.samplingRate) >> 7,
+				(MONITOR_PRETRIGGER * this.samplingRate) & 0x7f]);
 	}
 
 	// track midi object
@@ -133,6 +137,7 @@ class Monitor {
 	// receive a new monitoring stream
 	start(msg) {
 		this.incoming = new Array(msg.size);
+		this.pretrigger = msg.pretrigger;
 	}
 
 	// receive data on monitoring stream
@@ -221,11 +226,11 @@ class Monitor {
 		this.ctx.setLineDash([]);
 
 		this.ctx.beginPath();
-		var [x, y] = this.convert(0, values[0]);
+		var [x, y] = this.convert(-this.pretrigger / this.samplingRate, values[0]);
 		this.ctx.moveTo(x, y);
 
 		for (var i = 1; i < values.length; i++) {
-			[x, y] = this.convert(i / this.samplingRate, values[i]);
+			[x, y] = this.convert((i - this.pretrigger) / this.samplingRate, values[i]);
 			this.ctx.lineTo(x, y);
 		}
 
@@ -42,6 +42,9 @@ class Pad extends Observable {
 		setValue("pad-scan-time", this.scanTime);
 		setValue("pad-mask-time", this.maskTime);
 		setValue("pad-retrigger-time", this.retriggerTime);
+		setValue("pad-predict-time", this.predictTime);
+		setValue("pad-gate-time", this.gateTime);
+		setValue("pad-position-control", this.positionControl);
 
 		setValue("pad-head-threshold", this.headThreshold);
 		setValue("pad-head-sensitivity", this.headSensitivity);
@@ -49,6 +52,10 @@ class Pad extends Observable {
 		setValue("pad-rim-sensitivity", this.rimSensitivity);
 
 		// set field visibility based on pad type
+		// (a hi-hat's rim settings calibrate its pedal)
+		const pedal = this.zones == HIHAT_PAD;
+		document.querySelector("label[for=pad-rim-threshold]").textContent = pedal ? "Pedal open:" : "Rim threshold:";
+		document.querySelector("label[for=pad-rim-sensitivity]").textContent = pedal ? "Pedal closed:" : "Rim sensitivity:";
 	}
 
 	// update the pad
@@ -61,6 +68,9 @@ class Pad extends Observable {
 		this.updateValue("scanTime", "pad-scan-time");
 		this.updateValue("maskTime", "pad-mask-time");
 		this.updateValue("retriggerTime", "pad-retrigger-time");
+		this.updateValue("predictTime", "pad-predict-time");
+		this.updateValue("gateTime", "pad-gate-time");
+		this.updateValue("positionControl", "pad-position-control");
 
 		this.updateValue("headThreshold", "pad-head-threshold");
 		this.updateValue("headSensitivity", "pad-head-sensitivity");
@@ -0,0 +1,50 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include "arena.h"
+
+
+//
+//	Arena::allocate
+//
+
+int16_t* Arena::allocate(int user, int size) {
+	if (user == ARENA_MONITOR) {
+		if (size > top.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+
+		bottom.store(size, std::memory_order_release);
+		return samples;
+
+	} else {
+		if (DIAGNOSTICS_ARENA_SIZE - size < bottom.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+
+		top.store(DIAGNOSTICS_ARENA_SIZE - size, std::memory_order_release);
+		return samples + DIAGNOSTICS_ARENA_SIZE - size;
+	}
+}
+
+
+//
+//	Arena::release
+//
+
+void Arena::release(int user) {
+	if (user == ARENA_MONITOR) {
+		bottom.store(0, std::memory_order_release);
+
+	} else {
+		top.store(DIAGNOSTICS_ARENA_SIZE, std::memory_order_release);
+	}
+}
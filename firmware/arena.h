@@ -0,0 +1,59 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "config.h"
+
+
+//
+//	Arena users
+//
+
+enum {
+	ARENA_MONITOR,
+	ARENA_OSCILLOSCOPE
+};
+
+
+//
+//	Arena class
+//
+//	The monitor and the oscilloscope only hold samples while the control app
+//	watches them, so their captures share one block of memory that is sized
+//	for the larger of the two. The monitor takes its part from the bottom and
+//	the oscilloscope from the top, and a part is only handed out if it
+//	doesn't run into what the other one holds (otherwise the session waits
+//	until the other user is done). Parts are taken in the detection context
+//	when a session starts and are given back by whichever context is done
+//	with them.
+//
+
+class Arena {
+public:
+	// get storage for a number of samples (nullptr if the other user holds it)
+	int16_t* allocate(int user, int size);
+
+	// give storage back
+	void release(int user);
+
+private:
+	int16_t samples[DIAGNOSTICS_ARENA_SIZE];
+
+	// end of the monitor's part and start of the oscilloscope's part
+	std::atomic<int> bottom{0};
+	std::atomic<int> top{DIAGNOSTICS_ARENA_SIZE};
+};
@@ -24,12 +24,100 @@
 // sampling frequency (Fs)
 #define SAMPLING_RATE 20000
 
+// number of frames used to seed the sensor baselines at startup
+#define CALIBRATION_FRAMES 64
+
+// baseline tracking time constant (in frames, as a power of two)
+#define BASELINE_SHIFT 14
+
+// number of frames kept in scanner history (must be a power of two)
+#define SCANNER_HISTORY 8
+
 // maximum number of pads in kit
 #define PAD_COUNT 16
 
+// head/rim peak ratio above which the weaker zone is considered bleed
+#define ZONE_BLEED_RATIO 2
+
+// factor by which the retrigger level falls from the last peak over the retrigger time
+#define RETRIGGER_DECAY 8
+
+// time (in ms) an edge must be held to choke a ringing cymbal
+#define CHOKE_TIME 20
+
+// time (in ms) after a hit during which a cymbal rings and can be choked
+#define CHOKE_RING_TIME 3000
+
+// rate at which the learned centre and edge strike timings contract (as a power of two)
+#define POSITION_SHIFT 4
+
+// hi-hat pedal readings per second (the pedal is read every SAMPLING_RATE / HIHAT_RATE frames)
+#define HIHAT_RATE 1000
+
+// hi-hat pedal smoothing (one pole filter time constant in readings, as a power of two)
+#define HIHAT_FILTER_SHIFT 2
+
+// hi-hat pedal position (CC4) change required before it is sent and minimum time (in ms) between sends
+#define HIHAT_HYSTERESIS 2
+#define HIHAT_INTERVAL 10
+
+// hi-hat pedal position (0 to 127) from which the hi-hat is closed
+#define HIHAT_CLOSED 110
+
+// slowest and fastest full pedal travel (in ms), anything slower doesn't chick/splash
+// and anything faster has full velocity
+#define HIHAT_SLOW_TIME 150
+#define HIHAT_FAST_TIME 15
+
+// time (in ms) after closing in which opening the pedal again splashes
+#define HIHAT_SPLASH_TIME 150
+
+// notes for pedal chick and splash
+#define HIHAT_CHICK_NOTE 44
+#define HIHAT_SPLASH_NOTE 55
+
+// learning rate of the predictive velocity estimate (as a power of two)
+#define PREDICT_SHIFT 3
+
 // maximum number of bytes stored per pad
 #define MAX_BYTES_PER_PAD 32
 
+// crosstalk ratios are stored after the pads
+#define CROSSTALK_OFFSET (PAD_COUNT * MAX_BYTES_PER_PAD)
+
+// queues between the detection and background contexts (must be powers of two)
+#define HIT_QUEUE_SIZE 64
+#define COMMAND_QUEUE_SIZE 8
+
+// largest midi command passed to the detection context (in bytes)
+#define COMMAND_SIZE 48
+
+// samples shared by monitor and oscilloscope captures (room for the larger
+// of the two, 100 ms of 4 probes, so a monitor session and an oscilloscope
+// capture only run at the same time when they fit together)
+#define DIAGNOSTICS_ARENA_SIZE (SAMPLING_RATE / 1000 * 100 * 4)
+
+// RAM (in bytes) the firmware's long lived objects may take
+#define RAM_BUDGET (256 * 1024)
+
+// sysex bytes per second the USB MIDI link takes (one 512 byte high speed
+// packet of 128 events with 3 bytes each per 125us microframe)
+#define USB_MIDI_RATE (384 * 8000)
+
+// most sysex bytes a monitor or oscilloscope upload sends per background loop
+// pass (what the link takes in one sample tick, so hits found during an upload
+// wait at most a tick for the pass to end)
+#define SYSEX_BUDGET (USB_MIDI_RATE / SAMPLING_RATE)
+
+// longest gate time in milliseconds (pad settings travel as 7-bit sysex bytes)
+#define MAX_GATE_TIME 127
+
+// note off scheduler (slots of one millisecond, must be a power of two and
+// cover the longest gate time, events that can be pending at the same time)
+#define SCHEDULER_SLOTS 256
+#define SCHEDULER_RESOLUTION (SAMPLING_RATE / 1000)
+#define SCHEDULER_EVENTS 128
+
 // mux address pins
 #define MUX_A1 10
 #define MUX_A2 11
@@ -60,5 +148,9 @@ enum {
 	MIDI_OSCILLOSCOPE_REQUEST,
 	MIDI_OSCILLOSCOPE_START,
 	MIDI_OSCILLOSCOPE_DATA,
-	MIDI_OSCILLOSCOPE_END
+	MIDI_OSCILLOSCOPE_END,
+	MIDI_UPDATE_CROSSTALK,
+	MIDI_MONITOR_PACKED,
+	MIDI_OSCILLOSCOPE_PACKED,
+	MIDI_OSCILLOSCOPE_STREAM
 };
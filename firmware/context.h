@@ -8,6 +8,16 @@
 #pragma once
 
 
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+#include "config.h"
+#include "queue.h"
+
+
 //
 //	Forward reference (required because of circular dependencies)
 //
@@ -17,12 +27,47 @@ struct Scanner;
 struct Monitor;
 
 
+//
+//	Messages between the detection and background contexts
+//
+//	Detection runs at a higher priority than the background loop that handles
+//	USB. Hits go out through one queue as compact records stamped with the
+//	sample tick they were detected at (the gate is in milliseconds, for
+//	aftertouch and control change events the note and velocity fields hold
+//	the note/controller and value), configuration commands (midi messages that change state used by
+//	detection) come in through another.
+//
+
+enum {
+	HIT_NOTE,
+	HIT_AFTERTOUCH,
+	HIT_CONTROL
+};
+
+struct HitEvent {
+	unsigned long time;
+	uint8_t type;
+	uint8_t pad;
+	uint8_t note;
+	uint8_t velocity;
+	uint8_t gate;
+};
+
+struct Command {
+	uint8_t size;
+	uint8_t data[COMMAND_SIZE];
+};
+
+typedef Queue<HitEvent, HIT_QUEUE_SIZE> HitQueue;
+typedef Queue<Command, COMMAND_QUEUE_SIZE> CommandQueue;
+
+
 //
 //	Context structure
 //
 
 struct Context {
-	// current timestamp in nanoseconds
+	// current time in sample ticks (1 / SAMPLING_RATE seconds)
 	unsigned long now;
 
 	// the kit
@@ -33,4 +78,7 @@ struct Context {
 
 	// the monitor
 	Monitor* monitor;
+
+	// hits waiting to be sent
+	HitQueue* hits;
 };
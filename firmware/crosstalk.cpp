@@ -0,0 +1,95 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <EEPROM.h>
+
+#include "crosstalk.h"
+#include "pad.h"
+
+
+//
+//	Crosstalk::saveSettings
+//
+
+int Crosstalk::saveSettings(int offset) {
+	for (auto source = 0; source < PAD_COUNT; source++) {
+		for (auto target = 0; target < PAD_COUNT; target++) {
+			EEPROM.update(offset++, ratios[source][target]);
+		}
+	}
+
+	return offset;
+}
+
+
+//
+//	Crosstalk::loadSettings
+//
+
+int Crosstalk::loadSettings(int offset) {
+	for (auto source = 0; source < PAD_COUNT; source++) {
+		for (auto target = 0; target < PAD_COUNT; target++) {
+			// erased EEPROM reads as 0xff and means no suppression
+			int ratio = EEPROM.read(offset++);
+			setRatio(source, target, ratio <= 127 ? ratio : 0);
+		}
+	}
+
+	return offset;
+}
+
+
+//
+//	Crosstalk::setRatio
+//
+
+void Crosstalk::setRatio(int source, int target, int ratio) {
+	// a pad doesn't bleed into itself
+	if (source == target) {
+		ratio = 0;
+	}
+
+	ratios[source][target] = ratio;
+
+	if (ratio) {
+		sources[target] |= 1u << source;
+
+	} else {
+		sources[target] &= ~(1u << source);
+	}
+}
+
+
+//
+//	Crosstalk::getBleed
+//
+
+int Crosstalk::getBleed(int target, PadStates& s, unsigned long window) {
+	int bleed = 0;
+
+	for (uint32_t m = sources[target]; m; m &= m - 1) {
+		int source = __builtin_ctz(m);
+
+		// only hits that started within the window around ours count
+		long distance = (long) (s.headHitTime[target] - s.headHitTime[source]);
+
+		if (s.headState[source] != IDLE && distance <= (long) window && distance >= -(long) window) {
+			int peak = s.headVelocity[source] > s.rimVelocity[source] ? s.headVelocity[source] : s.rimVelocity[source];
+			int expected = (peak * ratios[source][target]) >> 7;
+
+			if (expected > bleed) {
+				bleed = expected;
+			}
+		}
+	}
+
+	return bleed;
+}
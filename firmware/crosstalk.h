@@ -0,0 +1,54 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+#include "config.h"
+
+
+//
+//	Forward reference
+//
+
+struct PadStates;
+
+
+//
+//	Crosstalk class
+//
+//	A ratio (in 1/128 units) for a source/target pair says how much of a hit
+//	on the source pad shows up as bleed on the target pad. Most pairs don't
+//	interfere, so each target keeps a bitmask of its sources and only those
+//	are checked when it has a candidate hit.
+//
+
+class Crosstalk {
+public:
+	// save/load ratios to/from EEPROM
+	int saveSettings(int offset);
+	int loadSettings(int offset);
+
+	// set ratio for a source/target pair (0 to 127, 0 disables suppression)
+	void setRatio(int source, int target, int ratio);
+
+	// determine bleed on target from hits on other pads within the window
+	int getBleed(int target, PadStates& s, unsigned long window);
+
+private:
+	// ratios indexed by source and target pad
+	uint8_t ratios[PAD_COUNT][PAD_COUNT] = {};
+
+	// pads that bleed into each pad (bitmask, pad 1 is bit 0)
+	uint32_t sources[PAD_COUNT] = {};
+};
@@ -0,0 +1,187 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_math.h>
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+
+//
+//	Sample kernels on packed 16 bit values
+//
+//	All kernels work on arrays with a multiple of 8 elements that are at least
+//	4 byte aligned. The Cortex-M7 versions process two samples per
+//	instruction with the DSP extension, host builds use SSE2 or NEON and
+//	everything else falls back to plain C. All variants produce identical
+//	results.
+//
+//	rectify:	out[i] = |in[i]| (saturated, so -32768 becomes 32767)
+//	threshold:	bit i of result is set when values[i] > thresholds[i]
+//	peakHold:	peaks[i] = max(peaks[i], values[i])
+//
+//	The plain C versions are always there, as the fallback and as the
+//	reference the others are tested against.
+//
+
+inline void rectifyScalar(const int16_t* in, int16_t* out, int count) {
+	for (auto i = 0; i < count; i++) {
+		out[i] = in[i] < 0 ? (in[i] == INT16_MIN ? INT16_MAX : -in[i]) : in[i];
+	}
+}
+
+inline uint32_t thresholdScalar(const int16_t* values, const int16_t* thresholds, int count) {
+	uint32_t result = 0;
+
+	for (auto i = 0; i < count; i++) {
+		result |= (uint32_t) (values[i] > thresholds[i]) << i;
+	}
+
+	return result;
+}
+
+inline void peakHoldScalar(int16_t* peaks, const int16_t* values, int count) {
+	for (auto i = 0; i < count; i++) {
+		peaks[i] = values[i] > peaks[i] ? values[i] : peaks[i];
+	}
+}
+
+#if defined(__ARM_FEATURE_DSP)
+
+inline uint32_t load16x2(const int16_t* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline void store16x2(int16_t* p, uint32_t v) {
+	memcpy(p, &v, sizeof(v));
+}
+
+inline void rectify(const int16_t* in, int16_t* out, int count) {
+	for (auto i = 0; i < count; i += 2) {
+		uint32_t v = load16x2(in + i);
+		uint32_t negated = __QSUB16(0, v);
+
+		// GE flags are set for lanes that are positive
+		__SSUB16(v, 0);
+		store16x2(out + i, __SEL(v, negated));
+	}
+}
+
+inline uint32_t threshold(const int16_t* values, const int16_t* thresholds, int count) {
+	uint32_t result = 0;
+
+	for (auto i = 0; i < count; i += 2) {
+		// GE flags are set for lanes that did not cross their threshold
+		__SSUB16(load16x2(thresholds + i), load16x2(values + i));
+		uint32_t crossed = __SEL(0, 0xffffffff);
+		result |= ((crossed & 1) | ((crossed >> 15) & 2)) << i;
+	}
+
+	return result;
+}
+
+inline void peakHold(int16_t* peaks, const int16_t* values, int count) {
+	for (auto i = 0; i < count; i += 2) {
+		uint32_t v = load16x2(values + i);
+		uint32_t p = load16x2(peaks + i);
+
+		// GE flags are set for lanes where the value is not below the peak
+		__SSUB16(v, p);
+		store16x2(peaks + i, __SEL(v, p));
+	}
+}
+
+#elif defined(__SSE2__)
+
+inline void rectify(const int16_t* in, int16_t* out, int count) {
+	for (auto i = 0; i < count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i negated = _mm_subs_epi16(_mm_setzero_si128(), v);
+		_mm_storeu_si128((__m128i*) (out + i), _mm_max_epi16(v, negated));
+	}
+}
+
+inline uint32_t threshold(const int16_t* values, const int16_t* thresholds, int count) {
+	uint32_t result = 0;
+
+	for (auto i = 0; i < count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (values + i));
+		__m128i t = _mm_loadu_si128((const __m128i*) (thresholds + i));
+		__m128i crossed = _mm_packs_epi16(_mm_cmpgt_epi16(v, t), _mm_setzero_si128());
+		result |= (uint32_t) (_mm_movemask_epi8(crossed) & 0xff) << i;
+	}
+
+	return result;
+}
+
+inline void peakHold(int16_t* peaks, const int16_t* values, int count) {
+	for (auto i = 0; i < count; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (values + i));
+		__m128i p = _mm_loadu_si128((const __m128i*) (peaks + i));
+		_mm_storeu_si128((__m128i*) (peaks + i), _mm_max_epi16(v, p));
+	}
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+inline void rectify(const int16_t* in, int16_t* out, int count) {
+	for (auto i = 0; i < count; i += 8) {
+		vst1q_s16(out + i, vqabsq_s16(vld1q_s16(in + i)));
+	}
+}
+
+inline uint32_t threshold(const int16_t* values, const int16_t* thresholds, int count) {
+	static const uint16_t weights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+	uint16x8_t w = vld1q_u16(weights);
+	uint32_t result = 0;
+
+	for (auto i = 0; i < count; i += 8) {
+		uint16x8_t crossed = vcgtq_s16(vld1q_s16(values + i), vld1q_s16(thresholds + i));
+		result |= (uint32_t) vaddvq_u16(vandq_u16(crossed, w)) << i;
+	}
+
+	return result;
+}
+
+inline void peakHold(int16_t* peaks, const int16_t* values, int count) {
+	for (auto i = 0; i < count; i += 8) {
+		vst1q_s16(peaks + i, vmaxq_s16(vld1q_s16(peaks + i), vld1q_s16(values + i)));
+	}
+}
+
+#else
+
+inline void rectify(const int16_t* in, int16_t* out, int count) {
+	rectifyScalar(in, out, count);
+}
+
+inline uint32_t threshold(const int16_t* values, const int16_t* thresholds, int count) {
+	return thresholdScalar(values, thresholds, count);
+}
+
+inline void peakHold(int16_t* peaks, const int16_t* values, int count) {
+	peakHoldScalar(peaks, values, count);
+}
+
+#endif
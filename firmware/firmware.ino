@@ -11,11 +11,13 @@
 
 #include <usb_midi.h>
 
+#include "arena.h"
 #include "config.h"
 #include "context.h"
 #include "kit.h"
 #include "monitor.h"
 #include "oscilloscope.h"
+#include "output.h"
 #include "scanner.h"
 
 
@@ -24,12 +26,84 @@
 //
 
 static IntervalTimer timer;
-static volatile bool ready = true;
 
 static Context context;
-static Oscilloscope oscilloscope;
+static Arena arena;
+static Oscilloscope oscilloscope(&arena);
+static Output output;
 
-static int counter = 1;
+// configuration commands for the detection context
+static CommandQueue commands;
+
+// overruns that were reported last
+static unsigned int reportedOverruns = 0;
+
+
+//
+//	RAM budget
+//
+//	Worst case RAM of the objects that live for the whole run (everything is
+//	allocated at startup, so this doesn't grow later). Build with RAM_REPORT
+//	defined to get the breakdown as a compiler warning.
+//
+
+static constexpr size_t kitSize =
+	sizeof(Kit) + PAD_COUNT * sizeof(Pad) + TYPE_COUNT * sizeof(Type) + CURVE_COUNT * sizeof(Curve);
+
+static constexpr size_t ramUsed =
+	sizeof(Scanner) + kitSize + sizeof(Monitor) + sizeof(Oscilloscope) + sizeof(Arena) +
+	sizeof(HitQueue) + sizeof(CommandQueue) + sizeof(Output);
+
+static_assert(ramUsed <= RAM_BUDGET, "Firmware objects exceed RAM_BUDGET");
+
+#ifdef RAM_REPORT
+template <size_t scanner, size_t kit, size_t monitor, size_t oscilloscope, size_t arena, size_t queues, size_t output, size_t total, size_t budget>
+[[deprecated("RAM report")]] static constexpr bool reportRam() { return true; }
+
+static_assert(reportRam<
+	sizeof(Scanner), kitSize, sizeof(Monitor), sizeof(Oscilloscope), sizeof(Arena),
+	sizeof(HitQueue) + sizeof(CommandQueue), sizeof(Output), ramUsed, RAM_BUDGET>(), "");
+#endif
+
+
+//
+//	Detection context
+//
+//	Runs from a software interrupt that the scanner triggers when a frame is
+//	complete. It has a lower priority than the scan timer and the ADC (so
+//	acquisition never stalls) but preempts the background loop, so USB
+//	traffic can't delay processing of a frame.
+//
+
+static void detect() {
+	// apply configuration changes queued by the background
+	Command command;
+
+	while (commands.pop(command)) {
+		uint8_t* data = command.data;
+
+		// handle monitoring requests
+		if (data[2] == MIDI_MONITOR_REQUEST) {
+			context.monitor->midiEvent(data, command.size);
+
+		// handle oscilloscope requests
+		} else if (data[2] == MIDI_OSCILLOSCOPE_REQUEST) {
+			oscilloscope.midiEvent(data, command.size);
+
+		} else {
+			// give message to kit
+			context.kit->midiEvent(data, command.size);
+		}
+	}
+
+	// take the latest frame and process it (while the next one is acquired)
+	if (context.scanner->available()) {
+		context.scanner->read();
+		context.now = context.scanner->getTime();
+		context.kit->process(&context);
+		oscilloscope.process(&context);
+	}
+}
 
 
 //
@@ -37,30 +111,37 @@ static int counter = 1;
 //
 
 void setup() {
-	// initialize scan timer
-	timer.begin([]() {
-		ready = true;
-	}, 1000000 / SAMPLING_RATE);
-
-	// create scanner, drumkit and monitor
+	// create scanner, drumkit, monitor and the hit queue
 	context.scanner = new Scanner();
 	context.kit = new Kit();
-	context.monitor = new Monitor();
+	context.monitor = new Monitor(&arena);
+	context.hits = new HitQueue();
+
+	// run detection from a software interrupt triggered by completed frames
+	attachInterruptVector(IRQ_SOFTWARE, detect);
+	NVIC_SET_PRIORITY(IRQ_SOFTWARE, 208);
+	NVIC_ENABLE_IRQ(IRQ_SOFTWARE);
+
+	context.scanner->setFrameHandler([]() {
+		NVIC_SET_PENDING(IRQ_SOFTWARE);
+	});
+
+	// initialize scan timer (which starts frame acquisition in the background)
+	timer.begin([]() {
+		context.scanner->start();
+	}, 1000000 / SAMPLING_RATE);
 
 	// setup midi event handling
 	usbMIDI.setHandleSystemExclusive([](uint8_t* data, unsigned int size) {
 		if (data[0] == 0xf0 && data[1] == MIDI_VENDOR_ID) {
-			// handle monitoring requests
-			if (data[2] == MIDI_MONITOR_REQUEST) {
-				context.monitor->midiEvent(data, size);
-
-			// handle oscilloscope requests
-		} else if (data[2] == MIDI_OSCILLOSCOPE_REQUEST) {
-				oscilloscope.midiEvent(data, size);
-
-			} else {
-				// give message to kit
-				context.kit->midiEvent(data, size);
+			// configuration requests and pad updates are handled right here (the
+			// kit hands prepared updates to detection), everything else changes
+			// state used by detection
+			if (!context.kit->midiRequest(data, size) && size <= COMMAND_SIZE) {
+				Command command;
+				command.size = size;
+				memcpy(command.data, data, size);
+				commands.push(command);
 			}
 		}
 	});
@@ -68,33 +149,32 @@ void setup() {
 
 
 //
-//	Firmware loop
+//	Background loop
 //
 
 void loop() {
-	// wait for next scan time
-	while (!ready) {
-		delayMicroseconds(4);
-	}
-
-	ready = false;
+	// send hits found by the detection context
+	output.drain(context.hits, context.scanner->getTime());
 
-	// get current time
-	context.now = micros();
-
-	// scan inputs and process them
-	//elapsedMicros time;
-	//Serial.println(time);
-	context.scanner->read();
-	context.kit->process(&context);
-	oscilloscope.process(&context);
+	// send part of completed monitor and oscilloscope captures (a bounded
+	// amount per pass so hits and midi input don't wait behind an upload)
+	int budget = context.monitor->transmit(SYSEX_BUDGET);
+	oscilloscope.transmit(budget);
 
 	// process midi inputs
 	usbMIDI.read();
 	usbMIDI.send_now();
 
-	if ((++counter % 10000) == 0) {
-		Serial.println(counter);
+	// report lost frames, hits and commands
+	unsigned int overruns = context.scanner->getOverruns() + context.hits->getOverruns() + commands.getOverruns();
+
+	if (overruns != reportedOverruns) {
+		Serial.print("overruns: frames ");
+		Serial.print(context.scanner->getOverruns());
+		Serial.print(", hits ");
+		Serial.print(context.hits->getOverruns());
+		Serial.print(", commands ");
+		Serial.println(commands.getOverruns());
+		reportedOverruns = overruns;
 	}
-
 }
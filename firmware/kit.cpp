@@ -9,9 +9,13 @@
 //	Include files
 //
 
+#include <limits.h>
+
 #include <usb_midi.h>
 
+#include "dsp.h"
 #include "kit.h"
+#include "monitor.h"
 
 
 //
@@ -36,6 +40,9 @@ Kit::Kit() {
 	for (auto i = 0; i < CURVE_COUNT; i++) {
 		curves[i] = new Curve(i);
 	}
+
+	// determine active sensors
+	configure();
 }
 
 
@@ -44,10 +51,94 @@ Kit::Kit() {
 //
 
 void Kit::process(Context* context) {
-	// process all pads
-	for (auto i = 0; i < 1; i++) {
-		pads[i]->process(context);
+	// switch pads to configurations the background has prepared (the acquire
+	// pairs with the release in midiRequest so all of it is seen)
+	uint32_t updated = updates.load(std::memory_order_acquire);
+
+	if (updated) {
+		for (uint32_t u = updated; u; u &= u - 1) {
+			pads[__builtin_ctz(u)]->update();
+		}
+
+		configure();
+		updates.fetch_and(~updated, std::memory_order_release);
+	}
+
+	// let the scanner know if we need other sensors
+	if (reconfigure) {
+		context->scanner->useSensors(SCANNER_KIT, sensors);
+		reconfigure = false;
+	}
+
+	// rectify entire frame, hold peaks and compare against the sensor trigger levels
+	rectify(context->scanner->getFrame(), sensorStates.rectified, NUMBER_OF_SENSORS);
+	peakHold(sensorStates.peaks, sensorStates.rectified, NUMBER_OF_SENSORS);
+	uint32_t crossed = threshold(sensorStates.rectified, sensorStates.thresholds, NUMBER_OF_SENSORS);
+
+	// find pads that are busy or see the start of a hit
+	uint32_t pending = busy;
+
+	while (crossed) {
+		int s = __builtin_ctz(crossed);
+		crossed &= crossed - 1;
+		pending |= sensorStates.pads[s];
+	}
+
+	// run the state machine for those pads only
+	uint32_t hits = 0;
+
+	while (pending) {
+		int i = __builtin_ctz(pending);
+		pending &= pending - 1;
+
+		if (pads[i]->process(context, states, sensorStates)) {
+			hits |= 1u << i;
+		}
+
+		if (states.headState[i] != IDLE) {
+			busy |= 1u << i;
+
+		} else {
+			busy &= ~(1u << i);
+		}
+	}
+
+	// keep the monitor's pre-trigger history of its pad going (after the pads,
+	// so a capture that started in this frame doesn't get the frame twice)
+	int monitored = context->monitor->getPad() - 1;
+
+	if (monitored >= 0 && monitored < PAD_COUNT) {
+		context->monitor->record(
+			sensorStates.rectified[states.headSensor[monitored]] >> 2,
+			sensorStates.rectified[states.rimSensor[monitored]] >> 2);
+	}
+
+	// send finished hits now that the peaks of all pads are known
+	while (hits) {
+		int i = __builtin_ctz(hits);
+		hits &= hits - 1;
+		pads[i]->sendHit(context, states, crosstalk);
+	}
+
+	// pedals change slowly, so they are only read at HIHAT_RATE
+	if (pedals && context->now - pedalTime >= SAMPLING_RATE / HIHAT_RATE) {
+		pedalTime = context->now;
+
+		for (uint32_t p = pedals; p; p &= p - 1) {
+			pads[__builtin_ctz(p)]->processPedal(context);
+		}
+	}
+
+	// sensors of pads that are handling a hit don't track their baseline
+	// (and a pedal's position is its DC level, so pedals never do)
+	uint32_t idle = ~pedalSensors;
+
+	for (uint32_t b = busy; b; b &= b - 1) {
+		idle &= ~pads[__builtin_ctz(b)]->getSensors();
 	}
+
+	// follow DC drift on idle sensors
+	context->scanner->track(idle);
 }
 
 
@@ -60,6 +151,8 @@ void Kit::saveSettings() {
 		int offset = i * MAX_BYTES_PER_PAD;
 		pads[i]->saveSettings(offset);
 	}
+
+	crosstalk.saveSettings(CROSSTALK_OFFSET);
 }
 
 
@@ -72,14 +165,69 @@ void Kit::loadSettings() {
 		int offset = i * MAX_BYTES_PER_PAD;
 		pads[i]->loadSettings(offset);
 	}
+
+	crosstalk.loadSettings(CROSSTALK_OFFSET);
+	configure();
 }
 
 
 //
-//	Kit::midiEvent
+//	Kit::configure
 //
 
-void Kit::midiEvent(uint8_t* data, unsigned int size) {
+void Kit::configure() {
+	sensors = 0;
+	pedals = 0;
+	pedalSensors = 0;
+
+	for (auto s = 0; s < NUMBER_OF_SENSORS; s++) {
+		sensorStates.thresholds[s] = INT16_MAX;
+		sensorStates.pads[s] = 0;
+	}
+
+	for (auto i = 0; i < PAD_COUNT; i++) {
+		pads[i]->configure(states);
+		sensors |= pads[i]->getSensors();
+
+		if (pads[i]->getPedal()) {
+			pedals |= 1u << i;
+			pedalSensors |= pads[i]->getPedal();
+		}
+
+		addTrigger(i, states.headSensor[i], states.headThreshold[i]);
+		addTrigger(i, states.rimSensor[i], states.rimThreshold[i]);
+	}
+
+	reconfigure = true;
+}
+
+
+//
+//	Kit::addTrigger
+//
+
+void Kit::addTrigger(int pad, int sensor, int threshold) {
+	// a sensor triggers at the lowest threshold of its pads
+	// (velocity = rectified >> 2 exceeds threshold t when rectified > t * 4 + 3)
+	if (threshold != INT_MAX) {
+		threshold = threshold * 4 + 3;
+
+		if (threshold < sensorStates.thresholds[sensor]) {
+			sensorStates.thresholds[sensor] = threshold;
+		}
+
+		sensorStates.pads[sensor] |= 1u << pad;
+	}
+}
+
+
+//
+//	Kit::midiRequest
+//
+
+bool Kit::midiRequest(uint8_t* data, unsigned int size) {
+	// pad configurations are only changed here, so they can be sent while
+	// detection runs
 	if (data[2] == MIDI_REQUEST_CONFIG) {
 		// send configuration
 		sendConfiguration();
@@ -101,6 +249,46 @@ void Kit::midiEvent(uint8_t* data, unsigned int size) {
 
 		// we're ready now
 		sendReady();
+		return true;
+
+	} else if (data[2] == MIDI_UPDATE_PAD) {
+		// prepare the new pad configuration here (building its velocity maps
+		// takes too long for a frame), detection switches to it
+		int id = data[3];
+
+		if (id >= 1 && id <= PAD_COUNT) {
+			uint32_t pad = 1u << (id - 1);
+
+			// an earlier update of the pad is picked up with the next frame
+			while (updates.load(std::memory_order_acquire) & pad) {
+			}
+
+			if (pads[id - 1]->receiveFromMidi(data, size)) {
+				updates.fetch_or(pad, std::memory_order_release);
+			}
+		}
+
+		return true;
+
+	} else {
+		return false;
+	}
+}
+
+
+//
+//	Kit::midiEvent
+//
+
+void Kit::midiEvent(uint8_t* data, unsigned int size) {
+	if (data[2] == MIDI_UPDATE_CROSSTALK && size >= 7) {
+		// update crosstalk ratio (source pad, target pad, ratio)
+		int source = data[3];
+		int target = data[4];
+
+		if (source >= 1 && source <= PAD_COUNT && target >= 1 && target <= PAD_COUNT) {
+			crosstalk.setRatio(source - 1, target - 1, data[5] & 0x7f);
+		}
 	}
 }
 
@@ -12,8 +12,11 @@
 //	Include files
 //
 
+#include <atomic>
+
 #include "config.h"
 #include "context.h"
+#include "crosstalk.h"
 #include "curve.h"
 #include "pad.h"
 #include "scanner.h"
@@ -23,6 +26,11 @@
 //
 //	Kit class
 //
+//	Pads and sensors are tracked in 32 bit masks during processing.
+//
+
+static_assert(PAD_COUNT <= 32, "PAD_COUNT can't exceed 32");
+static_assert(NUMBER_OF_SENSORS <= 32, "NUMBER_OF_SENSORS can't exceed 32");
 
 class Kit {
 public:
@@ -36,7 +44,9 @@ public:
 	void saveSettings();
 	void loadSettings();
 
-	// process midi events
+	// process midi events in the background (returns false for the ones that
+	// are left to the detection context) and in the detection context
+	bool midiRequest(uint8_t* data, unsigned int size);
 	void midiEvent(uint8_t* data, unsigned int size);
 
 	// send configuration
@@ -46,11 +56,25 @@ public:
 	void sendReady();
 
 private:
-	// input scanner
-	Scanner* scanner;
+	// determine sensors used by kit (after configuration changes)
+	void configure();
+	void addTrigger(int pad, int sensor, int threshold);
 
-	// pads that make up the drum kit
+	// pads that make up the drum kit (and their state)
 	Pad* pads[PAD_COUNT];
+	PadStates states = {};
+
+	// pads that are handling a hit (bitmask, pad 1 is bit 0)
+	uint32_t busy = 0;
+
+	// pads with a configuration prepared by the background (bitmask)
+	std::atomic<uint32_t> updates{0};
+
+	// bleed between pads
+	Crosstalk crosstalk;
+
+	// per sensor state for the current frame
+	SensorStates sensorStates = {};
 
 	// list of type
 	Type* types[TYPE_COUNT];
@@ -58,6 +82,15 @@ private:
 	// list of curves
 	Curve* curves[CURVE_COUNT];
 
+	// hi-hats with a pedal, their pedal sensors and time of the last pedal reading
+	uint32_t pedals = 0;
+	uint32_t pedalSensors = 0;
+	unsigned long pedalTime = 0;
+
+	// sensors used by pads (and flag to pass them on to the scanner)
+	uint32_t sensors = 0;
+	bool reconfigure = false;
+
 	// monitoring properties
 	int monitorPad = PAD_COUNT + 1;
 };
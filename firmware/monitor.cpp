@@ -21,13 +21,38 @@
 
 void Monitor::midiEvent(uint8_t* data, unsigned int size) {
 	if (data[2] == MIDI_MONITOR_REQUEST) {
-		// store monitor settings
+		// store monitor settings (pre-trigger length in samples and encoding are optional)
 		active = data[3];
 		pad = data[4];
+		pretrigger = size >= 8 ? min((data[5] << 7) | data[6], MONITOR_PRETRIGGER_SIZE) : 0;
+		encoding = size >= 9 && data[7] == ENCODING_PACKED ? ENCODING_PACKED : ENCODING_RAW;
 
-		// reset monitor
-		capturing = false;
-		p = 0;
+		// reset monitor (a session that is being sent is finished first)
+		if (capturing) {
+			capturing = false;
+			arena->release(ARENA_MONITOR);
+		}
+
+		recorded = 0;
+	}
+}
+
+
+//
+//	Monitor::record
+//
+
+void Monitor::record(int sample1, int sample2, int sample3) {
+	// the history is frozen while a session uses it
+	if (pretrigger && !capturing && !complete.load(std::memory_order_acquire)) {
+		history[0][h] = sample1;
+		history[1][h] = sample2;
+		history[2][h] = sample3;
+		h = (h + 1) & (MONITOR_PRETRIGGER_SIZE - 1);
+
+		if (recorded < MONITOR_PRETRIGGER_SIZE) {
+			recorded++;
+		}
 	}
 }
 
@@ -37,11 +62,25 @@ void Monitor::midiEvent(uint8_t* data, unsigned int size) {
 //
 
 void Monitor::start(int pd, int chans) {
-	// see if we are active and this is the pad we are capturing
-	if (active && pad == pd) {
+	// see if we are active and this is the pad we are capturing (and the last session was sent)
+	if (active && pad == pd && !complete.load(std::memory_order_acquire)) {
+		// get storage for the channels (the oscilloscope might be holding it)
+		buffer = arena->allocate(ARENA_MONITOR, chans * MONITOR_BUFFER_SIZE);
+
+		if (!buffer) {
+			return;
+		}
+
 		capturing = true;
 		channels = chans;
+		sessionPad = pad;
+		sessionEncoding = encoding;
 		p = 0;
+
+		// put the most recent history in front of the session
+		pre = min(pretrigger, recorded);
+		preStart = (h - pre) & (MONITOR_PRETRIGGER_SIZE - 1);
+		recorded = 0;
 	}
 }
 
@@ -55,9 +94,16 @@ void Monitor::sample(int pd, int sample1, int sample2, int sample3) {
 	if (capturing && pad == pd) {
 		// add sample to buffer (but avoid overflow)
 		if (p < MONITOR_BUFFER_SIZE) {
-			buffer[0][p] = sample1;
-			buffer[1][p] = sample2;
-			buffer[2][p] = sample3;
+			buffer[p] = sample1;
+
+			if (channels > 1) {
+				buffer[MONITOR_BUFFER_SIZE + p] = sample2;
+			}
+
+			if (channels > 2) {
+				buffer[2 * MONITOR_BUFFER_SIZE + p] = sample3;
+			}
+
 			p++;
 		}
 	}
@@ -71,22 +117,51 @@ void Monitor::sample(int pd, int sample1, int sample2, int sample3) {
 void Monitor::end(int pd) {
 	// ensure we are capturing this pad
 	if (capturing && pad == pd) {
-		// send data
-		for (auto i = 0; i < channels; i++) {
-			sendChannel(i);
-		}
-
-		// reset monitor
+		// hand data to the background and reset monitor
 		capturing = false;
+		complete.store(true, std::memory_order_release);
 	}
 }
 
 
 //
-//	Monitor::sendChannel
+//	Monitor::transmit
 //
 
-void Monitor::sendChannel(int channel) {
+int Monitor::transmit(int budget) {
+	// pick up where the last call stopped and send one message at a time
+	while (budget >= MONITOR_MESSAGE_SIZE && complete.load(std::memory_order_acquire)) {
+		if (sendOffset < 0) {
+			budget -= sendStart(sendChannel);
+			sendOffset = 0;
+
+		} else if (sendOffset < pre + p) {
+			int size = pre + p - sendOffset;
+			budget -= sendData(sendChannel, sendOffset, size);
+			sendOffset += size;
+
+		} else {
+			budget -= sendEnd(sendChannel);
+			sendOffset = -1;
+
+			// hand the storage back after the last channel
+			if (++sendChannel == channels) {
+				sendChannel = 0;
+				arena->release(ARENA_MONITOR);
+				complete.store(false, std::memory_order_release);
+			}
+		}
+	}
+
+	return budget;
+}
+
+
+//
+//	Monitor::sendStart
+//
+
+int Monitor::sendStart(int channel) {
 	// send start of monitoring message
 	struct {
 		uint8_t start;
@@ -96,29 +171,32 @@ void Monitor::sendChannel(int channel) {
 		uint8_t channel;
 		uint8_t sizeMsb;
 		uint8_t sizeLsb;
+		uint8_t pretriggerMsb;
+		uint8_t pretriggerLsb;
 		uint8_t end;
 	} startMsg = {
 		0xf0,
 		MIDI_VENDOR_ID,
 		MIDI_MONITOR_START,
-		(uint8_t) pad,
+		(uint8_t) sessionPad,
 		(uint8_t) (channel + 1),
-		(uint8_t) (p >> 7),
-		(uint8_t) (p & 0x7f),
+		(uint8_t) ((pre + p) >> 7),
+		(uint8_t) ((pre + p) & 0x7f),
+		(uint8_t) (pre >> 7),
+		(uint8_t) (pre & 0x7f),
 		0xf7
 	};
 
 	usbMIDI.sendSysEx(sizeof(startMsg), (uint8_t*) &startMsg, true);
+	return sizeof(startMsg);
+}
 
-	// send each of the chunks
-	int start = 0;
 
-	while (start < p) {
-		int size = min(MONITOR_CHUNK_SIZE, p - start);
-		sendData(channel, start, size);
-		start += size;
-	}
+//
+//	Monitor::sendEnd
+//
 
+int Monitor::sendEnd(int channel) {
 	// send end of monitoring message
 	struct {
 		uint8_t start;
@@ -131,12 +209,13 @@ void Monitor::sendChannel(int channel) {
 		0xf0,
 		MIDI_VENDOR_ID,
 		MIDI_MONITOR_END,
-		(uint8_t) pad,
+		(uint8_t) sessionPad,
 		(uint8_t) (channel + 1),
 		0xf7
 	};
 
 	usbMIDI.sendSysEx(sizeof(endMsg), (uint8_t*) &endMsg, true);
+	return sizeof(endMsg);
 }
 
 
@@ -144,7 +223,7 @@ void Monitor::sendChannel(int channel) {
 //	Monitor::sendData
 //
 
-void Monitor::sendData(int channel, int offset, int size) {
+int Monitor::sendData(int channel, int offset, int& size) {
 	// construct midi message
 	struct {
 		uint8_t start;
@@ -163,26 +242,49 @@ void Monitor::sendData(int channel, int offset, int size) {
 	msg.start = 0xf0;
 	msg.vendor = MIDI_VENDOR_ID;
 	msg.command = MIDI_MONITOR_DATA;
-	msg.pad = pad;
+	msg.pad = sessionPad;
 	msg.channel = channel + 1;
 	msg.offsetMsb = offset >> 7;
 	msg.offsetLsb = offset & 0x7f;
-	msg.sizeMsb = size >> 7;
-	msg.sizeLsb = size & 0x7f;
 	msg.end = 0xf7;
 
-	// make readings positive and split into 7-bit values
 	uint8_t* v = msg.values;
+	int packed = 0;
+
+	// pack as many samples as fit (if asked for)
+	if (sessionEncoding == ENCODING_PACKED) {
+		Packer packer(msg.values, sizeof(msg.values));
+
+		while (packed < size && packer.add(getValue(channel, offset + packed))) {
+			packed++;
+		}
 
-	for (auto i = 0; i < size; i++) {
-		auto offsetValue = buffer[channel][offset + i] + 1024;
-		*v++ = offsetValue >> 7;
-		*v++ = offsetValue & 0x7f;
+		v += packer.finish();
 	}
 
+	// use it unless a raw chunk carries more
+	if (packed >= min(size, MONITOR_CHUNK_SIZE)) {
+		msg.command = MIDI_MONITOR_PACKED;
+		size = packed;
+
+	} else {
+		// make readings positive and split into 7-bit values
+		size = min(size, MONITOR_CHUNK_SIZE);
+		v = msg.values;
+
+		for (auto i = 0; i < size; i++) {
+			auto offsetValue = getValue(channel, offset + i) + 1024;
+			*v++ = offsetValue >> 7;
+			*v++ = offsetValue & 0x7f;
+		}
+	}
+
+	msg.sizeMsb = size >> 7;
+	msg.sizeLsb = size & 0x7f;
 	*v++ = 0xf7;
 
 	// send message
 	auto msgSize = v - (uint8_t*) &msg;
 	usbMIDI.sendSysEx(msgSize, (uint8_t*) &msg, true);
+	return msgSize;
 }
@@ -12,7 +12,13 @@
 //	Include files
 //
 
+#include <stdint.h>
+
+#include <atomic>
+
+#include "arena.h"
 #include "config.h"
+#include "packer.h"
 
 
 //
@@ -22,35 +28,106 @@
 #define MONITOR_BUFFER_SIZE (SAMPLING_RATE / 1000 * 100)
 #define MONITOR_CHUNK_SIZE 50
 
+// largest message sent to the control app (a data chunk)
+#define MONITOR_MESSAGE_SIZE (2 * MONITOR_CHUNK_SIZE + 10)
+
+static_assert(SYSEX_BUDGET >= MONITOR_MESSAGE_SIZE, "SYSEX_BUDGET must fit a monitor data message");
+
+// longest pre-trigger history in samples (must be a power of two)
+#define MONITOR_PRETRIGGER_SIZE 128
+
+static_assert(3 * MONITOR_BUFFER_SIZE <= DIAGNOSTICS_ARENA_SIZE, "DIAGNOSTICS_ARENA_SIZE must fit a monitor session");
+static_assert((MONITOR_PRETRIGGER_SIZE & (MONITOR_PRETRIGGER_SIZE - 1)) == 0, "MONITOR_PRETRIGGER_SIZE must be a power of two");
+
 
 //
 //	Monitor class
 //
+//	While the monitored pad waits for a hit, the kit feeds its sensors into
+//	a small history ring. When a capture starts, the last samples of the
+//	ring are put in front of it (by reference, the ring isn't written again
+//	until the capture has been sent) so the onset of the hit is visible.
+//	The session itself is stored in the diagnostics arena, which gives us
+//	room for as many channels as the pad has when it starts.
+//
+//	A completed session is sent a few messages at a time so the background
+//	loop is never held up by a whole upload. The transmit position survives
+//	between calls and the buffers go back to the detection context once the
+//	end message of the last channel is out. If the control app asks for it,
+//	data messages are packed (see packer.h) and carry as many samples as fit
+//	in the space of a raw chunk.
+//
 
 class Monitor {
 public:
+	// constructor
+	Monitor(Arena* arena) : arena(arena) {}
+
 	// process midi events
 	void midiEvent(uint8_t* data, unsigned int size);
 
-	// sampling sessions
+	// get pad being monitored (0 if none)
+	inline int getPad() {
+		return active ? pad : 0;
+	}
+
+	// sampling sessions (called from the detection context)
+	void record(int sample1, int sample2=0, int sample3=0);
 	void start(int pad, int channels);
 	void sample(int pad, int sample1, int sample2=0, int sample3=0);
 	void end(int pad);
 
-private:
-	// send channel monitoring to control app
-	void sendChannel(int channel);
-	void sendData(int channel, int offset, int size);
+	// send part of a completed session to the control app (called from the
+	// background, sends at most budget bytes and returns what is left of it)
+	int transmit(int budget);
 
-	// flags
+private:
+	// send monitoring messages to control app (return number of bytes sent,
+	// the size of a data message goes in as samples left and comes out as
+	// samples sent)
+	int sendStart(int channel);
+	int sendData(int channel, int offset, int& size);
+	int sendEnd(int channel);
+
+	// get a value of the session (the pre-trigger samples come first)
+	inline int getValue(int channel, int i) {
+		return i < pre ? history[channel][(preStart + i) & (MONITOR_PRETRIGGER_SIZE - 1)] : buffer[channel * MONITOR_BUFFER_SIZE + i - pre];
+	}
+
+	// flags (a complete session is owned by the background until it is sent)
 	int active = false;
 	int capturing = false;
+	std::atomic<bool> complete{false};
 
 	// pad we are tracking and number of channels
 	int pad = 0;
 	int channels = 0;
 
-	// buffers to store monitored values
-	int buffer[3][MONITOR_BUFFER_SIZE];
+	// storage for the session (one MONITOR_BUFFER_SIZE row per channel)
+	Arena* arena;
+	int16_t* buffer = nullptr;
 	int p = 0;
+
+	// history ring (next position to write and number of samples in it) and
+	// requested pre-trigger length
+	int16_t history[3][MONITOR_PRETRIGGER_SIZE];
+	int h = 0;
+	int recorded = 0;
+	int pretrigger = 0;
+
+	// encoding of data messages
+	int encoding = ENCODING_RAW;
+
+	// pad and encoding of the current session (a request that comes in while
+	// it is sent doesn't change them)
+	int sessionPad = 0;
+	int sessionEncoding = ENCODING_RAW;
+
+	// pre-trigger samples of the current session (start in history ring and length)
+	int preStart = 0;
+	int pre = 0;
+
+	// transmit position in a complete session (offset is -1 before the start message)
+	int sendChannel = 0;
+	int sendOffset = -1;
 };
@@ -9,6 +9,8 @@
 //	Include files
 //
 
+#include <Arduino.h>
+
 #include "oscilloscope.h"
 #include "scanner.h"
 
@@ -19,16 +21,41 @@
 
 void Oscilloscope::midiEvent(uint8_t* data, unsigned int size) {
 	if (data[2] == MIDI_OSCILLOSCOPE_REQUEST) {
-		// store oscilloscope settings
+		// store oscilloscope settings (encoding, mode, trigger and decimation are optional)
 		active = data[3];
-		probes[0] = data[4];
-		probes[1] = data[5];
-		probes[2] = data[6];
-		probes[3] = data[7];
 
-		// reset oscilloscope
-		capturing = false;
-		p = 0;
+		for (auto i = 0; i < 4; i++) {
+			probes[i] = data[4 + i] <= NUMBER_OF_SENSORS ? data[4 + i] : 0;
+		}
+
+		encoding = size >= 10 && data[8] == ENCODING_PACKED ? ENCODING_PACKED : ENCODING_RAW;
+
+		if (size >= 18) {
+			mode = data[9] == OSCILLOSCOPE_STREAM ? OSCILLOSCOPE_STREAM : OSCILLOSCOPE_SINGLE;
+			triggerProbe = data[10] >= 1 && data[10] <= 4 ? data[10] - 1 : 0;
+			edge = data[11] <= OSCILLOSCOPE_FALLING ? data[11] : (int) OSCILLOSCOPE_EITHER;
+			level = ((data[12] << 7) | data[13]) - 1024;
+			pretrigger = min((data[14] << 7) | data[15], OSCILLOSCOPE_BUFFER_SIZE - 1);
+			decimation = data[16] ? data[16] : OSCILLOSCOPE_DECIMATION;
+
+		} else {
+			mode = OSCILLOSCOPE_SINGLE;
+			triggerProbe = 0;
+			edge = OSCILLOSCOPE_EITHER;
+			level = OSCILLOSCOPE_LEVEL;
+			pretrigger = 0;
+			decimation = OSCILLOSCOPE_DECIMATION;
+		}
+
+		// reset oscilloscope (a capture that is being sent is finished first)
+		if (armed) {
+			armed = false;
+			capturing = false;
+			arena->release(ARENA_OSCILLOSCOPE);
+		}
+
+		frames = 0;
+		reconfigure = true;
 	}
 }
 
@@ -38,42 +65,246 @@ void Oscilloscope::midiEvent(uint8_t* data, unsigned int size) {
 //
 
 void Oscilloscope::process(Context* context) {
-	// see if we are capturing
-	if (capturing) {
-		// capture all the probes
+	// let the scanner know which sensors we are probing
+	if (reconfigure) {
+		uint32_t sensors = 0;
+
 		for (auto i = 0; i < 4; i++) {
-			if (probes[i]) {
-				buffer[i][p] = context->scanner->getValue(probes[i]);
+			if (active && probes[i]) {
+				sensors |= 1u << (probes[i] - 1);
 			}
 		}
 
-		// send data to controller if required
-		if (++p == OSCILLOSCOPE_BUFFER_SIZE) {
-			for (auto i = 0; i < 4; i++) {
-				if (probes[i]) {
-					sendProbe(i);
-				}
+		context->scanner->useSensors(SCANNER_OSCILLOSCOPE, sensors);
+		reconfigure = false;
+	}
+
+	if (active) {
+		if (mode == OSCILLOSCOPE_STREAM) {
+			processStream(context);
+
+		} else {
+			processSingle(context);
+		}
+	}
+}
+
+
+//
+//	Oscilloscope::processSingle
+//
+
+void Oscilloscope::processSingle(Context* context) {
+	// get storage once the last capture was sent
+	if (!armed) {
+		if (complete.load(std::memory_order_acquire)) {
+			return;
+		}
+
+		int count = 0;
+
+		for (auto i = 0; i < 4; i++) {
+			count += probes[i] != 0;
+		}
+
+		// the monitor might be holding the storage
+		int16_t* storage = count ? arena->allocate(ARENA_OSCILLOSCOPE, count * OSCILLOSCOPE_BUFFER_SIZE) : nullptr;
+
+		if (!storage) {
+			return;
+		}
+
+		for (auto i = 0, row = 0; i < 4; i++) {
+			buffers[i] = probes[i] ? storage + OSCILLOSCOPE_BUFFER_SIZE * row++ : nullptr;
+		}
+
+		armed = true;
+		p = 0;
+		recorded = 0;
+		previous = level;
+	}
+
+	// record all the probes
+	for (auto i = 0; i < 4; i++) {
+		if (buffers[i]) {
+			buffers[i][p] = context->scanner->getValue(probes[i]);
+		}
+	}
+
+	int value = buffers[triggerProbe] ? buffers[triggerProbe][p] : 0;
+
+	if (++p == OSCILLOSCOPE_BUFFER_SIZE) {
+		p = 0;
+	}
+
+	if (recorded < OSCILLOSCOPE_BUFFER_SIZE) {
+		recorded++;
+	}
+
+	// see if we need to start capturing (keeping what we have from before the trigger)
+	if (!capturing && buffers[triggerProbe] && triggered(value)) {
+		pre = min(pretrigger, recorded - 1);
+		first = p - 1 - pre;
+		first += first < 0 ? OSCILLOSCOPE_BUFFER_SIZE : 0;
+		remaining = OSCILLOSCOPE_BUFFER_SIZE - 1 - pre;
+		capturing = true;
+
+	} else if (capturing) {
+		remaining--;
+	}
+
+	previous = value;
+
+	// hand data to the background when the capture is in
+	if (capturing && !remaining) {
+		armed = false;
+		capturing = false;
+		complete.store(true, std::memory_order_release);
+	}
+}
+
+
+//
+//	Oscilloscope::processStream
+//
+
+void Oscilloscope::processStream(Context* context) {
+	// start a new point
+	if (!frames) {
+		for (auto i = 0; i < 4; i++) {
+			point.min[i] = INT16_MAX;
+			point.max[i] = INT16_MIN;
+		}
+	}
+
+	// track the envelope of all the probes
+	int used = 0;
+
+	for (auto i = 0; i < 4; i++) {
+		if (probes[i]) {
+			used |= 1 << i;
+			int16_t value = context->scanner->getValue(probes[i]);
+
+			if (value < point.min[i]) {
+				point.min[i] = value;
 			}
 
-			// reset state
-			capturing = false;
-			p = 0;
+			if (value > point.max[i]) {
+				point.max[i] = value;
+			}
 		}
+	}
 
-	// see if we need to start capturing
-	} else if (active && probes[0]) {
-		if (abs(context->scanner->getValue(probes[0])) > 25) {
-			capturing = true;
+	// hand the point to the background at the end of the window (a full queue drops it)
+	if (++frames == decimation) {
+		if (used) {
+			point.probes = used;
+			point.sequence = sequence++ & 0x7f;
+			stream.push(point);
 		}
+
+		frames = 0;
 	}
 }
 
 
 //
-//	Oscilloscope::sendData
+//	Oscilloscope::triggered
+//
+
+bool Oscilloscope::triggered(int value) {
+	if (edge == OSCILLOSCOPE_RISING) {
+		return previous < level && value >= level;
+
+	} else if (edge == OSCILLOSCOPE_FALLING) {
+		return previous > level && value <= level;
+
+	} else {
+		return abs(value) > level;
+	}
+}
+
+
+//
+//	Oscilloscope::transmit
+//
+
+int Oscilloscope::transmit(int budget) {
+	// pick up where the last call stopped and send one message at a time
+	while (budget >= OSCILLOSCOPE_MESSAGE_SIZE && complete.load(std::memory_order_acquire)) {
+		if (sendOffset < 0) {
+			// skip probes that weren't captured
+			while (!buffers[sendProbe]) {
+				sendProbe++;
+			}
+
+			budget -= sendStart(sendProbe);
+			sendOffset = 0;
+
+		} else if (sendOffset < OSCILLOSCOPE_BUFFER_SIZE) {
+			int size = OSCILLOSCOPE_BUFFER_SIZE - sendOffset;
+			budget -= sendData(sendProbe, sendOffset, size);
+			sendOffset += size;
+
+		} else {
+			budget -= sendEnd(sendProbe);
+			sendOffset = -1;
+
+			// move on to the next captured probe or hand the storage back after the last one
+			do {
+				sendProbe++;
+			} while (sendProbe < 4 && !buffers[sendProbe]);
+
+			if (sendProbe == 4) {
+				sendProbe = 0;
+				arena->release(ARENA_OSCILLOSCOPE);
+				complete.store(false, std::memory_order_release);
+			}
+		}
+	}
+
+	// collect streamed points and send them when a message is full or the
+	// first of them has waited long enough (a stream that stops or slows
+	// down leaves a partial message)
+	OscilloscopePoint next;
+
+	while (budget >= OSCILLOSCOPE_MESSAGE_SIZE) {
+		if (pendingCount && pendingCount == (OSCILLOSCOPE_MESSAGE_SIZE - 7) / (4 * __builtin_popcount(pending[0].probes))) {
+			budget -= sendStream(pending, pendingCount);
+			pendingCount = 0;
+
+		} else if (stream.pop(next)) {
+			// a change of probes starts a new message
+			if (pendingCount && pending[0].probes != next.probes) {
+				budget -= sendStream(pending, pendingCount);
+				pendingCount = 0;
+			}
+
+			if (!pendingCount) {
+				pendingTime = micros();
+			}
+
+			pending[pendingCount++] = next;
+
+		} else {
+			if (pendingCount && micros() - pendingTime >= OSCILLOSCOPE_STREAM_TIMEOUT * 1000) {
+				budget -= sendStream(pending, pendingCount);
+				pendingCount = 0;
+			}
+
+			break;
+		}
+	}
+
+	return budget;
+}
+
+
+//
+//	Oscilloscope::sendStart
 //
 
-void Oscilloscope::sendProbe(int probe) {
+int Oscilloscope::sendStart(int probe) {
 	// send start of scope message
 	struct {
 		uint8_t start;
@@ -82,6 +313,8 @@ void Oscilloscope::sendProbe(int probe) {
 		uint8_t probe;
 		uint8_t sizeMsb;
 		uint8_t sizeLsb;
+		uint8_t pretriggerMsb;
+		uint8_t pretriggerLsb;
 		uint8_t end;
 	} startMsg = {
 		0xf0,
@@ -90,20 +323,21 @@ void Oscilloscope::sendProbe(int probe) {
 		(uint8_t) (probe + 1),
 		OSCILLOSCOPE_BUFFER_SIZE >> 7,
 		OSCILLOSCOPE_BUFFER_SIZE & 0x7f,
+		(uint8_t) (pre >> 7),
+		(uint8_t) (pre & 0x7f),
 		0xf7
 	};
 
 	usbMIDI.sendSysEx(sizeof(startMsg), (uint8_t*) &startMsg, true);
+	return sizeof(startMsg);
+}
 
-	// send each of the chunks
-	int start = 0;
 
-	while (start < OSCILLOSCOPE_BUFFER_SIZE) {
-		int size = min(OSCILLOSCOPE_CHUNK_SIZE, OSCILLOSCOPE_BUFFER_SIZE - start);
-		sendData(probe, start, size);
-		start += size;
-	}
+//
+//	Oscilloscope::sendEnd
+//
 
+int Oscilloscope::sendEnd(int probe) {
 	// send end of scope message
 	struct {
 		uint8_t start;
@@ -120,7 +354,7 @@ void Oscilloscope::sendProbe(int probe) {
 	};
 
 	usbMIDI.sendSysEx(sizeof(endMsg), (uint8_t*) &endMsg, true);
-	Serial.println("MIDI_OSCILLOSCOPE_END");
+	return sizeof(endMsg);
 }
 
 
@@ -128,7 +362,7 @@ void Oscilloscope::sendProbe(int probe) {
 //	Oscilloscope::sendData
 //
 
-void Oscilloscope::sendData(int probe, int offset, int size) {
+int Oscilloscope::sendData(int probe, int offset, int& size) {
 	// construct midi message
 	struct {
 		uint8_t start;
@@ -149,17 +383,89 @@ void Oscilloscope::sendData(int probe, int offset, int size) {
 	msg.probe = probe + 1;
 	msg.offsetMsb = offset >> 7;
 	msg.offsetLsb = offset & 0x7f;
+	msg.end = 0xf7;
+
+	uint8_t* v = msg.values;
+	int packed = 0;
+
+	// pack as many samples as fit (if asked for)
+	if (encoding == ENCODING_PACKED) {
+		Packer packer(msg.values, sizeof(msg.values));
+
+		while (packed < size && packer.add(getValue(probe, offset + packed))) {
+			packed++;
+		}
+
+		v += packer.finish();
+	}
+
+	// use it unless a raw chunk carries more
+	if (packed >= min(size, OSCILLOSCOPE_CHUNK_SIZE)) {
+		msg.command = MIDI_OSCILLOSCOPE_PACKED;
+		size = packed;
+
+	} else {
+		// make readings positive and split into 7-bit values
+		size = min(size, OSCILLOSCOPE_CHUNK_SIZE);
+		v = msg.values;
+
+		for (auto i = 0; i < size; i++) {
+			auto offsetValue = getValue(probe, offset + i) + 1024;
+			*v++ = offsetValue >> 7;
+			*v++ = offsetValue & 0x7f;
+		}
+	}
+
 	msg.sizeMsb = size >> 7;
 	msg.sizeLsb = size & 0x7f;
+	*v++ = 0xf7;
+
+	// send message
+	auto msgSize = v - (uint8_t*) &msg;
+	usbMIDI.sendSysEx(msgSize, (uint8_t*) &msg, true);
+	return msgSize;
+}
+
+
+//
+//	Oscilloscope::sendStream
+//
+
+int Oscilloscope::sendStream(OscilloscopePoint* points, int count) {
+	// construct midi message
+	struct {
+		uint8_t start;
+		uint8_t vendor;
+		uint8_t command;
+		uint8_t probes;
+		uint8_t sequence;
+		uint8_t count;
+		uint8_t values[2 * OSCILLOSCOPE_CHUNK_SIZE];
+		uint8_t end;
+	} msg;
+
+	msg.start = 0xf0;
+	msg.vendor = MIDI_VENDOR_ID;
+	msg.command = MIDI_OSCILLOSCOPE_STREAM;
+	msg.probes = points[0].probes;
+	msg.sequence = points[0].sequence;
+	msg.count = count;
 	msg.end = 0xf7;
 
-	// make readings positive and split into 7-bit values
+	// send minimum and maximum of each probe in use (positive and split into 7-bit values)
 	uint8_t* v = msg.values;
 
-	for (auto i = 0; i < size; i++) {
-		auto offsetValue = buffer[probe][offset + i] + 1024;
-		*v++ = offsetValue >> 7;
-		*v++ = offsetValue & 0x7f;
+	for (auto i = 0; i < count; i++) {
+		for (auto probe = 0; probe < 4; probe++) {
+			if (points[i].probes & (1 << probe)) {
+				auto minimum = points[i].min[probe] + 1024;
+				auto maximum = points[i].max[probe] + 1024;
+				*v++ = minimum >> 7;
+				*v++ = minimum & 0x7f;
+				*v++ = maximum >> 7;
+				*v++ = maximum & 0x7f;
+			}
+		}
 	}
 
 	*v++ = 0xf7;
@@ -167,4 +473,5 @@ void Oscilloscope::sendData(int probe, int offset, int size) {
 	// send message
 	auto msgSize = v - (uint8_t*) &msg;
 	usbMIDI.sendSysEx(msgSize, (uint8_t*) &msg, true);
+	return msgSize;
 }
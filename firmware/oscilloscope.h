@@ -14,8 +14,13 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
+#include "arena.h"
 #include "config.h"
 #include "context.h"
+#include "packer.h"
+#include "queue.h"
 
 
 //
@@ -25,34 +30,158 @@
 #define OSCILLOSCOPE_BUFFER_SIZE (SAMPLING_RATE / 1000 * 100)
 #define OSCILLOSCOPE_CHUNK_SIZE 50
 
+// trigger level used by requests that don't set one
+#define OSCILLOSCOPE_LEVEL 25
+
+// samples per streamed min/max point used by requests that don't set it
+// (1000 points per second) and points waiting to be streamed (must be a power of two)
+#define OSCILLOSCOPE_DECIMATION (SAMPLING_RATE / 1000)
+#define OSCILLOSCOPE_STREAM_SIZE 256
+
+// longest time (in ms) streamed points wait for their message to fill up
+#define OSCILLOSCOPE_STREAM_TIMEOUT 10
+
+// largest message sent to the control app (a data chunk)
+#define OSCILLOSCOPE_MESSAGE_SIZE (2 * OSCILLOSCOPE_CHUNK_SIZE + 9)
+
+static_assert(4 * OSCILLOSCOPE_BUFFER_SIZE <= DIAGNOSTICS_ARENA_SIZE, "DIAGNOSTICS_ARENA_SIZE must fit an oscilloscope capture");
+static_assert(SYSEX_BUDGET >= OSCILLOSCOPE_MESSAGE_SIZE, "SYSEX_BUDGET must fit an oscilloscope data message");
+
+
+//
+//	Oscilloscope modes and trigger edges
+//
+
+enum {
+	OSCILLOSCOPE_SINGLE,
+	OSCILLOSCOPE_STREAM
+};
+
+enum {
+	OSCILLOSCOPE_EITHER,
+	OSCILLOSCOPE_RISING,
+	OSCILLOSCOPE_FALLING
+};
+
+
+//
+//	Streamed point (envelope of all probes over a decimation window)
+//
+
+struct OscilloscopePoint {
+	int16_t min[4];
+	int16_t max[4];
+	uint8_t probes;
+	uint8_t sequence;
+};
+
 
 //
 //	Oscilloscope class
 //
+//	In single shot mode, the oscilloscope takes storage from the diagnostics
+//	arena (one row per probe in use) as soon as it is armed and records into
+//	it as a ring, so samples from before the trigger are at hand. Once the
+//	trigger probe crosses the level and the rest of the capture is in, the
+//	capture is sent a few messages at a time and the storage is only given
+//	back once every probe has been sent. Data messages are packed in the
+//	same way as the monitor's if asked for.
+//
+//	In streaming mode, every probe is reduced to the minimum and maximum of
+//	each decimation window. That costs a couple of compares per probe per
+//	frame, and the points go to the background through a queue, numbered
+//	so the control app can see if any were dropped.
+//
 
 class Oscilloscope {
 public:
+	// constructor
+	Oscilloscope(Arena* arena) : arena(arena) {}
+
 	// process midi events
 	void midiEvent(uint8_t* data, unsigned int size);
 
-	// process cycle
+	// process cycle (called from the detection context)
 	void process(Context* context);
 
-private:
-	// send probe data to control app
-	void sendProbe(int probe);
-	void sendData(int probe, int offset, int size);
+	// send part of a completed capture to the control app (called from the
+	// background, sends at most budget bytes and returns what is left of it)
+	int transmit(int budget);
 
-	// flags
+private:
+	// send probe messages to control app (return number of bytes sent, the
+	// size of a data message goes in as samples left and comes out as samples
+	// sent)
+	int sendStart(int probe);
+	int sendData(int probe, int offset, int& size);
+	int sendEnd(int probe);
+	int sendStream(OscilloscopePoint* points, int count);
+
+	// process a frame in each of the modes
+	void processSingle(Context* context);
+	void processStream(Context* context);
+
+	// see if a value of the trigger probe fires the trigger
+	bool triggered(int value);
+
+	// get a value of the capture (the ring starts at the first sample)
+	inline int getValue(int probe, int i) {
+		i += first;
+		return buffers[probe][i < OSCILLOSCOPE_BUFFER_SIZE ? i : i - OSCILLOSCOPE_BUFFER_SIZE];
+	}
+
+	// flags (armed holds storage and records, capturing waits for the rest of
+	// the capture after the trigger and a complete capture is owned by the
+	// background until it is sent)
 	int active = false;
+	int armed = false;
 	int capturing = false;
+	std::atomic<bool> complete{false};
 
-	// probe targets
+	// probe targets (and flag to pass them on to the scanner)
 	int probes[4] = {0};
+	bool reconfigure = false;
+
+	// encoding of data messages
+	int encoding = ENCODING_RAW;
+
+	// mode, trigger (probe, edge, level and samples kept from before it) and
+	// samples per streamed point
+	int mode = OSCILLOSCOPE_SINGLE;
+	int triggerProbe = 0;
+	int edge = OSCILLOSCOPE_EITHER;
+	int level = OSCILLOSCOPE_LEVEL;
+	int pretrigger = 0;
+	int decimation = OSCILLOSCOPE_DECIMATION;
 
-	// probe values
-	int buffer[4][OSCILLOSCOPE_BUFFER_SIZE];
+	// storage for the capture and the row of each probe (nullptr if not captured)
+	Arena* arena;
+	int16_t* buffers[4] = {nullptr};
 
-	// buffer pointer
+	// ring position, number of samples recorded and last value of the trigger probe
 	int p = 0;
+	int recorded = 0;
+	int previous = 0;
+
+	// samples still to record after the trigger and ring position and number
+	// of pre-trigger samples of the capture
+	int remaining = 0;
+	int first = 0;
+	int pre = 0;
+
+	// transmit position in a complete capture (probe being sent and offset,
+	// -1 before the start message)
+	int sendProbe = 0;
+	int sendOffset = -1;
+
+	// point being reduced (and frames in it), points for the background and
+	// points the background is collecting for the next stream message (and
+	// when the first of them came in, in microseconds)
+	OscilloscopePoint point;
+	int frames = 0;
+	uint8_t sequence = 0;
+	Queue<OscilloscopePoint, OSCILLOSCOPE_STREAM_SIZE> stream;
+	OscilloscopePoint pending[OSCILLOSCOPE_CHUNK_SIZE / 2];
+	int pendingCount = 0;
+	unsigned long pendingTime = 0;
 };
@@ -0,0 +1,69 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <usb_midi.h>
+
+#include "output.h"
+
+
+//
+//	Output::drain
+//
+
+int Output::drain(HitQueue* hits, unsigned long now) {
+	HitEvent hit;
+	int sent = 0;
+	bool flush = false;
+
+	while (hits->pop(hit)) {
+		if (hit.type == HIT_AFTERTOUCH) {
+			usbMIDI.sendAfterTouchPoly(hit.note, hit.velocity, MIDI_CHANNEL);
+
+		} else if (hit.type == HIT_CONTROL) {
+			usbMIDI.sendControlChange(hit.note, hit.velocity, MIDI_CHANNEL);
+
+		} else {
+			usbMIDI.sendNoteOn(hit.note, hit.velocity, MIDI_CHANNEL);
+
+			// the gate starts when the hit was detected and replaces the gate of an
+			// earlier hit on the same note (without a free event we can't wait)
+			if (!hit.gate || !scheduler.schedule(hit.time + hit.gate * SCHEDULER_RESOLUTION, hit.note)) {
+				scheduler.cancel(hit.note);
+				usbMIDI.sendNoteOff(hit.note, 0, MIDI_CHANNEL);
+			}
+		}
+
+		// detection may have queued hits after our clock was read (those are on time)
+		long delay = (long) (now - hit.time);
+
+		if (delay > (long) latency) {
+			latency = delay;
+		}
+
+		sent++;
+		flush = true;
+	}
+
+	// send note offs whose gate has closed
+	uint8_t note;
+
+	while (scheduler.next(now, note)) {
+		usbMIDI.sendNoteOff(note, 0, MIDI_CHANNEL);
+		flush = true;
+	}
+
+	// flush the whole batch at once
+	if (flush) {
+		usbMIDI.send_now();
+	}
+
+	return sent;
+}
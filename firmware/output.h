@@ -0,0 +1,46 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include "config.h"
+#include "context.h"
+#include "scheduler.h"
+
+
+//
+//	Output class
+//
+//	Turns hit records queued by the detection context into midi messages.
+//	All hits that are waiting are written as one batch of USB packets that
+//	is flushed once, so a roll on several pads doesn't cost a USB transfer
+//	per note. Note offs follow when the gate of the hit closes (or right
+//	away for a zero gate).
+//
+
+class Output {
+public:
+	// send all queued hits and note offs that are due (returns number of hits sent)
+	int drain(HitQueue* hits, unsigned long now);
+
+	// get largest delay between detecting and sending a hit (in sample ticks)
+	inline unsigned long getLatency() {
+		return latency;
+	}
+
+private:
+	// pending note offs
+	Scheduler scheduler;
+
+	// largest delay seen
+	unsigned long latency = 0;
+};
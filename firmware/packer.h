@@ -0,0 +1,272 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+
+//
+//	Sysex encodings for captured samples (requested by the control app)
+//
+
+enum {
+	ENCODING_RAW,
+	ENCODING_PACKED
+};
+
+
+//
+//	Packer class
+//
+//	Packs samples into 7-bit sysex bytes. Every sample becomes the zig-zag
+//	coded difference with the one before it (the first one with 0), shifted
+//	left with a clear low bit. Stretches where the signal doesn't change
+//	become a single token instead: the length of the run, shifted left by
+//	two with low bits 01. Tokens go out in groups of 6 bits (lowest first)
+//	and bit 6 says another group follows.
+//
+//	Idle sensors wander by a few LSB, which would still cost a byte per
+//	sample. Three to five differences of -3 to 3 in a row are therefore
+//	packed into one token with low bits 11, followed by 3 bits per
+//	difference (a field of 100 ends a group early). Two unchanged samples
+//	end a group and start a run. The top bit of its last
+//	group is set, so its size gives the number of fields: 3 in 2 bytes or 5
+//	in 3 bytes. Quiet signals take less than a byte per sample, where raw
+//	values take two.
+//
+//	The packer fills a payload of a fixed size and add() refuses the first
+//	sample that wouldn't fit. Every payload starts over from 0, so a message
+//	can be decoded on its own.
+//
+
+#define PACKER_SMALL 3
+#define PACKER_GROUP 5
+
+class Packer {
+public:
+	// constructor
+	Packer(uint8_t* payload, int capacity) : payload(payload), capacity(capacity) {}
+
+	// add a sample (returns false if it doesn't fit)
+	bool add(int value) {
+		int delta = value - previous;
+		bool small = delta >= -PACKER_SMALL && delta <= PACKER_SMALL;
+
+		// work out what has to be written and what stays pending
+		int written = 0;
+		unsigned int r = 0;
+		int k = 0;
+
+		if (delta == 0 && !count) {
+			r = run + 1;
+
+		} else if (delta == 0 && deltas[count - 1] == 0) {
+			// a second unchanged sample ends the group and starts a run
+			written = groupSize(count - 1);
+			r = 2;
+
+		} else if (small) {
+			written = runSize(run);
+			k = count + 1;
+
+			if (k == PACKER_GROUP) {
+				written += groupSize(k);
+				k = 0;
+			}
+
+		} else {
+			written = runSize(run) + groupSize(count) + tokenSize(deltaToken(delta));
+		}
+
+		if (used + written + runSize(r) + groupSize(k) > capacity) {
+			return false;
+		}
+
+		// a changed sample ends a run, a large difference ends a group
+		if (r) {
+			if (count) {
+				count--;
+				flushGroup();
+			}
+
+			run = r;
+
+		} else if (small) {
+			flushRun();
+			deltas[count++] = delta;
+
+			if (count == PACKER_GROUP) {
+				flushGroup();
+			}
+
+		} else {
+			flushRun();
+			flushGroup();
+			write(deltaToken(delta));
+		}
+
+		previous = value;
+		return true;
+	}
+
+	// finish the payload (returns number of bytes used)
+	int finish() {
+		flushRun();
+		flushGroup();
+		return used;
+	}
+
+private:
+	// number of bytes a token takes
+	static int tokenSize(unsigned int token) {
+		int size = 1;
+
+		while (token >>= 6) {
+			size++;
+		}
+
+		return size;
+	}
+
+	// token of a difference
+	static unsigned int deltaToken(int delta) {
+		return (delta >= 0 ? (unsigned int) delta << 1 : ((unsigned int) -delta << 1) - 1) << 1;
+	}
+
+	// number of bytes a pending run or group takes (short groups go out as differences)
+	static int runSize(unsigned int run) {
+		return run ? tokenSize((run << 2) | 1) : 0;
+	}
+
+	static int groupSize(int count) {
+		return count < 3 ? count : (count == 3 ? 2 : 3);
+	}
+
+	// write a token in 6-bit groups
+	void write(unsigned int token) {
+		while (token >> 6) {
+			payload[used++] = 0x40 | (token & 0x3f);
+			token >>= 6;
+		}
+
+		payload[used++] = token;
+	}
+
+	// write pending run of unchanged samples
+	void flushRun() {
+		if (run) {
+			write((run << 2) | 1);
+			run = 0;
+		}
+	}
+
+	// write pending small differences
+	void flushGroup() {
+		if (count < 3) {
+			for (auto i = 0; i < count; i++) {
+				write(deltaToken(deltas[i]));
+			}
+
+		} else {
+			int fields = count == 3 ? 3 : 5;
+			unsigned int token = 3;
+
+			for (auto i = 0; i < fields; i++) {
+				token |= (i < count ? deltas[i] & 7 : 4) << (2 + 3 * i);
+			}
+
+			write(token | 1u << (fields == 3 ? 11 : 17));
+		}
+
+		count = 0;
+	}
+
+	uint8_t* payload;
+	int capacity;
+	int used = 0;
+
+	// last sample, number of unchanged samples and small differences that are still to be written
+	int previous = 0;
+	unsigned int run = 0;
+	int deltas[PACKER_GROUP];
+	int count = 0;
+};
+
+
+//
+//	Unpack a payload made by the Packer (the reference decoder for the
+//	control app, returns number of samples or -1 if the payload is malformed)
+//
+
+inline int unpack(const uint8_t* payload, int length, int16_t* values, int size) {
+	int count = 0;
+	int value = 0;
+	int i = 0;
+
+	while (i < length) {
+		// collect the groups of a token
+		unsigned int token = 0;
+		int shift = 0;
+
+		do {
+			if (i == length || shift > 24) {
+				return -1;
+			}
+
+			token |= (payload[i] & 0x3f) << shift;
+			shift += 6;
+
+		} while (payload[i++] & 0x40);
+
+		// a group holds 2 fields per byte it took (less one)
+		if ((token & 3) == 3) {
+			for (auto field = 0; field < shift / 3 - 1; field++) {
+				int delta = (token >> (2 + 3 * field)) & 7;
+
+				if (delta == 4) {
+					break;
+				}
+
+				if (count == size) {
+					return -1;
+				}
+
+				value += delta > 4 ? delta - 8 : delta;
+				values[count++] = value;
+			}
+
+			continue;
+		}
+
+		// a run repeats the last value, anything else is a difference
+		int repeat = 1;
+
+		if (token & 1) {
+			repeat = token >> 2;
+
+		} else {
+			unsigned int zigzag = token >> 1;
+			value += zigzag & 1 ? -(int) ((zigzag + 1) >> 1) : (int) (zigzag >> 1);
+		}
+
+		if (count + repeat > size) {
+			return -1;
+		}
+
+		while (repeat--) {
+			values[count++] = value;
+		}
+	}
+
+	return count;
+}
@@ -9,26 +9,16 @@
 //	Include files
 //
 
+#include <limits.h>
+#include <math.h>
+
 #include <WString.h>
 #include <EEPROM.h>
-#include <usb_midi.h>
 
 #include "pad.h"
 #include "monitor.h"
 #include "scanner.h"
-
-
-//
-//	Pad trigger states
-//
-
-enum {
-	IDLE,
-	SCANNING,
-	MASK,
-	RETRIGGER,
-	CHOKE
-};
+#include "type.h"
 
 
 //
@@ -37,8 +27,13 @@ enum {
 
 Pad::Pad(int i) {
 	id = i;
-	headState = IDLE;
-	curve = Curve(p.curve);
+
+	// spread pads over the sensors by default
+	p.headSensor = i;
+	p.rimSensor = i + PAD_COUNT;
+	received = p;
+	prepare();
+	update();
 }
 
 
@@ -57,95 +52,558 @@ int Pad::saveSettings(int offset) {
 
 int Pad::loadSettings(int offset) {
 	offset = p.loadSettings(offset);
-	curve =Curve(p.curve);
+	received = p;
+	prepare();
+	update();
 	return offset;
 }
 
 
+//
+//	Pad::configure
+//
+
+void Pad::configure(PadStates& s) {
+	int i = id - 1;
+
+	if (p.headSensor >= 1 && p.headSensor <= NUMBER_OF_SENSORS) {
+		s.headSensor[i] = p.headSensor - 1;
+		s.headThreshold[i] = p.headThreshold;
+
+	} else {
+		s.headSensor[i] = 0;
+		s.headThreshold[i] = INT_MAX;
+	}
+
+	// head and rim are scanned together on multi-zone pads
+	if ((p.zones == DUAL_ZONE || p.zones == TRIPLE_ZONE) && p.rimSensor >= 1 && p.rimSensor <= NUMBER_OF_SENSORS) {
+		s.rimSensor[i] = p.rimSensor - 1;
+		s.rimThreshold[i] = p.rimThreshold;
+
+	} else {
+		s.rimSensor[i] = 0;
+		s.rimThreshold[i] = INT_MAX;
+	}
+}
+
+
 //
 //	Pad::process
 //
 
-void Pad::process(Context* context) {
-	// get current value (-512 to 512), rectify it and get it to midi range (0 to 127)
-	int value = context->scanner->getValue(p.headSensor);
-	int velocity = abs(value) >> 2;
+bool Pad::process(Context* context, PadStates& s, SensorStates& sensors) {
+	// get our state from the state arrays
+	int i = id - 1;
+	uint8_t& headState = s.headState[i];
+	int& headVelocity = s.headVelocity[i];
+	int& rimVelocity = s.rimVelocity[i];
+	unsigned long& headStateStartTime = s.headStateStartTime[i];
+	unsigned long& headStateDuration = s.headStateDuration[i];
+	unsigned long& headHitTime = s.headHitTime[i];
+	unsigned long& headPeakTime = s.headPeakTime[i];
+	unsigned long& headZeroCrossingTime = s.headZeroCrossingTime[i];
+
+	// get current value (-512 to 512) and its rectified version in midi range (0 to 127)
+	// (a pad without a valid head sensor only plays its rim, the sensor it was
+	// given is someone else's)
+	int sensor = s.headSensor[i];
+	int headThreshold = s.headThreshold[i];
+	bool hasHead = headThreshold != INT_MAX;
+	int value = hasHead ? context->scanner->getValue(sensor + 1) : 0;
+	int velocity = hasHead ? sensors.rectified[sensor] >> 2 : 0;
+
+	// the rim (if any) only needs its peak, which the kit holds for us
+	int rim = s.rimSensor[i];
+	bool hasRim = s.rimThreshold[i] != INT_MAX;
+
+	// after the scan window, the level holds the peak of the last hit during
+	// mask and follows its decay during retrigger, anything that rises above
+	// it is a new hit (ringing stays below it); the edge switch of a cymbal
+	// is left out, holding it isn't a new hit
+	if (headState == MASK || headState == RETRIGGER) {
+		context->monitor->sample(id, velocity, sensors.rectified[rim] >> 2);
+		uint32_t& headEnvelope = s.headEnvelope[i];
+
+		if (headState == RETRIGGER) {
+			headEnvelope = (headEnvelope * retriggerDecay) >> 16;
+		}
+
+		int level = hasRim && !choke && (sensors.rectified[rim] >> 2) > velocity ? sensors.rectified[rim] >> 2 : velocity;
+
+		if ((uint32_t) level << 8 > headEnvelope) {
+			headState = IDLE;
+			context->monitor->end(id);
+
+		} else if (headState == MASK) {
+			if (context->now - headStateStartTime > headStateDuration) {
+				headState = RETRIGGER;
+				headStateStartTime = context->now;
+				headStateDuration = retriggerTicks;
+			}
+
+		} else if (context->now - headStateStartTime > headStateDuration) {
+			// cymbals keep ringing (and their edge is watched) for a while
+			if (choke && hasRim) {
+				headState = CHOKE;
+				headStateStartTime = context->now;
+				headStateDuration = CHOKE_RING_TIME * (SAMPLING_RATE / 1000);
+				s.headContact[i] = 0;
+				s.headContactLevel[i] = 0;
+				s.headChoked[i] = false;
+
+			} else {
+				headState = IDLE;
+			}
+
+			context->monitor->end(id);
+		}
+	}
+
+	// while a cymbal rings, holding its edge (sustained contact on the rim
+	// switch without a hit on the head) chokes it until the edge is let go;
+	// a hit on the edge rises well past the level at which contact started
+	// and is played instead
+	if (headState == CHOKE) {
+		int edge = sensors.rectified[rim] >> 2;
+		bool contact = edge > p.rimThreshold;
+		int& contactTicks = s.headContact[i];
+		int& contactLevel = s.headContactLevel[i];
+
+		if (velocity > headThreshold) {
+			// a new hit ends the choke
+			if (s.headChoked[i]) {
+				sendChoke(context, 0);
+			}
+
+			headState = IDLE;
+
+		} else if (s.headChoked[i]) {
+			if (!contact) {
+				sendChoke(context, 0);
+				headState = IDLE;
+			}
+
+		} else if (contact) {
+			// the first two ticks set the contact level (a switch can close during a conversion)
+			if (contactTicks < 2) {
+				contactLevel = edge > contactLevel ? edge : contactLevel;
+			}
+
+			if (edge > contactLevel + p.rimThreshold) {
+				// still rising, start the hit like any other
+				headState = IDLE;
+
+			} else if (++contactTicks >= CHOKE_TIME * (SAMPLING_RATE / 1000)) {
+				sendChoke(context, 127);
+				s.headChoked[i] = true;
+			}
+
+		} else {
+			contactTicks = 0;
+			contactLevel = 0;
+
+			if (context->now - headStateStartTime > headStateDuration) {
+				headState = IDLE;
+			}
+		}
+	}
 
 	// waiting for a hit
 	if (headState == IDLE) {
-		if (velocity > p.headThreshold) {
-			// we have the start of a hit, start the scanning phase
+		if (velocity > headThreshold || (hasRim && (sensors.rectified[rim] >> 2) > p.rimThreshold)) {
+			// we have the start of a hit (on head or rim), start the scanning phase
+			if (hasHead) {
+				sensors.peaks[sensor] = sensors.rectified[sensor];
+			}
+
+			if (hasRim) {
+				sensors.peaks[rim] = sensors.rectified[rim];
+			}
+
 			headVelocity = velocity;
+			rimVelocity = hasRim ? sensors.rectified[rim] >> 2 : 0;
+			s.headGain[i] = 256;
+			s.headPredicted[i] = false;
+			lobePeak = 0;
 			headHitTime = context->now;
 			headPeakTime = context->now;
 			headZeroCrossingTime = 0;
+			s.headArrivalTime[i] = velocity > headThreshold ? context->now : 0;
+			s.rimArrivalTime[i] = rimVelocity > p.rimThreshold ? context->now : 0;
 
 			headState = SCANNING;
 			headStateStartTime = context->now;
-			headStateDuration = p.scanTime * 1000;
+			headStateDuration = scanTicks;
 
 			// if we are the target of monitoring, start that as well
-			context->monitor->start(id, 1);
-			context->monitor->sample(id, velocity);
+			context->monitor->start(id, hasRim ? 2 : 1);
+			context->monitor->sample(id, velocity, sensors.rectified[rim] >> 2);
 		}
 
 	// handle scanning cycle
 	} else if (headState == SCANNING) {
-		// detect peak
-		if (velocity > headVelocity) {
-			headVelocity = velocity;
+		// detect peak (the kit holds the sensor's peak for us)
+		int peak = hasHead ? sensors.peaks[sensor] >> 2 : 0;
+
+		if (peak > headVelocity) {
+			headVelocity = peak;
 			headPeakTime = context->now;
 		}
 
+		if (hasRim) {
+			rimVelocity = sensors.peaks[rim] >> 2;
+
+			if (!s.rimArrivalTime[i] && rimVelocity > p.rimThreshold) {
+				s.rimArrivalTime[i] = context->now;
+			}
+		}
+
+		if (!s.headArrivalTime[i] && headVelocity > headThreshold) {
+			s.headArrivalTime[i] = context->now;
+		}
+
 		// detect zero crossing
-		if (!headZeroCrossingTime && (value * context->scanner->getPrevious(p.headSensor)) < 0) {
+		if (!headZeroCrossingTime && (value * context->scanner->getValue(sensor + 1, 1)) < 0) {
 			headZeroCrossingTime = context->now;
 		}
 
 		// handle monitoring requirements
-		context->monitor->sample(id, velocity);
+		context->monitor->sample(id, velocity, sensors.rectified[rim] >> 2);
 
 		if (context->now - headStateStartTime > headStateDuration) {
-			// limit velocity to sensitivity (if required)
-			if (headVelocity > p.headSensitivity) {
-				headVelocity = p.headSensitivity;
+			// enter mask phase (the retrigger level starts at the peak of the hit)
+			headState = MASK;
+			headStateStartTime = context->now;
+			headStateDuration = maskTicks;
+			s.headEnvelope[i] = (uint32_t) (headVelocity > rimVelocity ? headVelocity : rimVelocity) << 8;
+
+			// the kit sends the hit once all pads are processed (unless it was sent early)
+			if (s.headPredicted[i]) {
+				learn(s);
+				return false;
 			}
 
-			// map input signal to full midi range
-			headVelocity = ((headVelocity - p.headThreshold) * 127) /
-				(p.headSensitivity - p.headThreshold);
+			return true;
 
-			// apply curve
-			headVelocity = curve.apply(headVelocity);
+		} else if (p.predictTime) {
+			return predict(context, s, velocity);
+		}
+	}
 
-			// send note
-			usbMIDI.sendNoteOn(p.headNote, headVelocity, MIDI_CHANNEL);
-			usbMIDI.sendNoteOff(p.headNote, 0, MIDI_CHANNEL);
+	return false;
+}
 
-			// enter mask phase
-			headState = MASK;
-			headStateStartTime = context->now;
-			headStateDuration = p.maskTime * 1000;
+
+//
+//	Pad::predict
+//
+
+bool Pad::predict(Context* context, PadStates& s, int velocity) {
+	int i = id - 1;
+	unsigned long elapsed = context->now - s.headHitTime[i];
+
+	// the first lobe has peaked once the signal crosses zero or falls below half its peak
+	if (!lobePeak && (s.headZeroCrossingTime[i] || velocity * 2 < s.headVelocity[i])) {
+		lobePeak = s.headVelocity[i];
+		lobeTime = s.headPeakTime[i] - s.headHitTime[i];
+	}
+
+	if (s.headPredicted[i]) {
+		return false;
+
+	} else if (lobePeak) {
+		// scale the first lobe by what earlier hits on this pad did afterwards
+		s.headGain[i] = lobeGain;
+
+	} else if (elapsed >= predictTicks) {
+		// out of time while still rising, follow the rise slope up to the usual rise time
+		unsigned long rising = s.headPeakTime[i] - s.headHitTime[i] + 1;
+		int extrapolation = riseTime > rising ? (riseTime * 256) / rising : 256;
+		s.headGain[i] = (lobeGain * (extrapolation < 512 ? extrapolation : 512)) >> 8;
+
+	} else {
+		return false;
+	}
+
+	s.headPredicted[i] = true;
+	return true;
+}
+
+
+//
+//	Pad::learn
+//
+
+void Pad::learn(PadStates& s) {
+	// hits that ended before the first lobe was detected teach us nothing
+	if (lobePeak) {
+		int i = id - 1;
+		lobeGain += ((s.headVelocity[i] * 256) / lobePeak - lobeGain) >> PREDICT_SHIFT;
+		riseTime = riseTime ? riseTime + (((long) lobeTime - (long) riseTime) >> PREDICT_SHIFT) : lobeTime;
+	}
+}
+
+
+//
+//	Pad::sendHit
+//
+
+void Pad::sendHit(Context* context, PadStates& s, Crosstalk& crosstalk) {
+	// remove bleed from other pads that were hit at the same time
+	int i = id - 1;
+	int bleed = crosstalk.getBleed(i, s, scanTicks);
+	int headVelocity = ((s.headVelocity[i] * s.headGain[i]) >> 8) - bleed;
+	int rimVelocity = ((s.rimVelocity[i] * s.headGain[i]) >> 8) - bleed;
+
+	// determine zones that were hit
+	bool headHit = s.headThreshold[i] != INT_MAX && headVelocity > p.headThreshold;
+	bool rimHit = s.rimThreshold[i] != INT_MAX && rimVelocity > p.rimThreshold;
+
+	// when both zones see the hit, a much weaker one is just bleed
+	// (comparable peaks are a rimshot and trigger both notes)
+	if (headHit && rimHit) {
+		if (rimVelocity * ZONE_BLEED_RATIO < headVelocity) {
+			rimHit = false;
+
+		} else if (headVelocity * ZONE_BLEED_RATIO < rimVelocity) {
+			headHit = false;
 		}
+	}
 
-	// handle mask phase
-	} else if (headState == MASK) {
-		context->monitor->sample(id, velocity);
+	// send notes (the bow of a hi-hat plays the rim note when the pedal is closed)
+	const VelocityMap& velocityMap = maps[map];
 
-		if (context->now - headStateStartTime > headStateDuration) {
-			headState = RETRIGGER;
-			headStateStartTime = context->now;
-			headStateDuration = p.retriggerTime * 1000;
+	if (headHit) {
+		// the position goes out just ahead of the note it belongs to (controllers
+		// from 120 up are channel mode messages)
+		if (p.positionControl && p.positionControl < 120) {
+			context->hits->push({context->now, HIT_CONTROL, (uint8_t) id, (uint8_t) p.positionControl, (uint8_t) estimatePosition(s), 0});
 		}
 
-	// handle retrigger period
-	} else if (headState == RETRIGGER) {
-		context->monitor->sample(id, velocity);
+		sendNote(context, p.zones == HIHAT && pedalClosed ? p.rimNote : p.headNote, headVelocity, velocityMap.head);
+	}
 
-		if (context->now - headStateStartTime > headStateDuration) {
-			headState = IDLE;
-			context->monitor->end(id);
+	if (rimHit) {
+		sendNote(context, p.rimNote, rimVelocity, velocityMap.rim);
+	}
+}
+
+
+//
+//	Pad::estimatePosition
+//
+//	Hits near the edge of a head ring at a higher frequency than hits in the
+//	centre, so the first lobe is shorter. Its length follows from the rise
+//	time (a quarter period) and the first zero crossing (half a period). On
+//	pads with a rim sensor, the difference in arrival time is added as well
+//	(the head sensor sees centre hits first). Timings are scaled between the
+//	longest (centre) and shortest (edge) seen on the pad, both of which slowly
+//	move towards new hits so a single outlier doesn't stick.
+//
+
+int Pad::estimatePosition(PadStates& s) {
+	int i = id - 1;
+	long rise = s.headPeakTime[i] - s.headHitTime[i];
+	long period = s.headZeroCrossingTime[i] ? 2 * rise + (long) (s.headZeroCrossingTime[i] - s.headHitTime[i]) : 4 * rise;
+
+	if (s.headArrivalTime[i] && s.rimArrivalTime[i]) {
+		period += (long) (s.rimArrivalTime[i] - s.headArrivalTime[i]);
+	}
+
+	// the rim can see the hit well before the head, there is no timing to go by then
+	if (period <= 0) {
+		return 0;
+	}
+
+	// update learned range
+	int timing = period << 4;
+
+	if (!positionCentre || timing > positionCentre) {
+		positionCentre = timing;
+
+	} else {
+		positionCentre += (timing - positionCentre) >> POSITION_SHIFT;
+	}
+
+	if (!positionEdge || timing < positionEdge) {
+		positionEdge = timing;
+
+	} else {
+		positionEdge += (timing - positionEdge) >> POSITION_SHIFT;
+	}
+
+	// the ringing frequency (not the period) goes up about linearly towards the edge
+	int range = positionCentre - positionEdge;
+
+	if (range <= 0 || positionEdge <= 0) {
+		return 0;
+	}
+
+	int position = (int) (((int64_t) (positionCentre - timing) * positionEdge * 127) / ((int64_t) timing * range));
+	return position < 0 ? 0 : (position > 127 ? 127 : position);
+}
+
+
+//
+//	Pad::prepare
+//
+
+void Pad::prepare() {
+	curve = Curve(received.curve);
+
+	// the retrigger level falls by RETRIGGER_DECAY over the retrigger time
+	unsigned long ticks = received.retriggerTime * (SAMPLING_RATE / 1000);
+	receivedDecay = ticks ? (uint32_t) (65536.0 * exp(-log((double) RETRIGGER_DECAY) / ticks)) : 0;
+
+	// build new maps next to the active ones (update() switches over)
+	VelocityMap& velocityMap = maps[map ^ 1];
+	buildVelocityMap(velocityMap.head, received.headThreshold, received.headSensitivity);
+	buildVelocityMap(velocityMap.rim, received.rimThreshold, received.rimSensitivity);
+}
+
+
+//
+//	Pad::update
+//
+
+void Pad::update() {
+	p = received;
+
+	// durations are set in milliseconds, pads count sample ticks
+	scanTicks = p.scanTime * (SAMPLING_RATE / 1000);
+	maskTicks = p.maskTime * (SAMPLING_RATE / 1000);
+	retriggerTicks = p.retriggerTime * (SAMPLING_RATE / 1000);
+	predictTicks = p.predictTime * (SAMPLING_RATE / 1000);
+	retriggerDecay = receivedDecay;
+
+	// only cymbals watch their edge after a hit, other pads go straight back to idle
+	choke = canChoke(p.type);
+
+	// switch to the prepared maps in one go
+	map ^= 1;
+}
+
+
+//
+//	Pad::buildVelocityMap
+//
+
+void Pad::buildVelocityMap(uint8_t* velocityMap, int threshold, int sensitivity) {
+	for (auto i = 0; i < VELOCITY_MAP_SIZE; i++) {
+		// peaks at or below the threshold never reach the map
+		if (i <= threshold) {
+			velocityMap[i] = 0;
+
+		// without a range above the threshold every hit is a full one
+		} else if (sensitivity <= threshold) {
+			velocityMap[i] = curve.apply(127);
+
+		} else {
+			// limit velocity to sensitivity, map input signal to full midi range and apply curve
+			int velocity = i < sensitivity ? i : sensitivity;
+			velocityMap[i] = curve.apply(((velocity - threshold) * 127) / (sensitivity - threshold));
+		}
+	}
+}
+
+
+//
+//	Pad::sendNote
+//
+
+void Pad::sendNote(Context* context, int note, int velocity, const uint8_t* velocityMap) {
+	// map peak to final velocity (anything above the map is beyond sensitivity)
+	velocity = velocityMap[velocity < VELOCITY_MAP_SIZE ? velocity : VELOCITY_MAP_SIZE - 1];
+
+	// leave sending to the background (a full queue drops the hit and counts it)
+	context->hits->push({context->now, HIT_NOTE, (uint8_t) id, (uint8_t) note, (uint8_t) velocity, (uint8_t) p.gateTime});
+}
+
+
+//
+//	Pad::sendChoke
+//
+
+void Pad::sendChoke(Context* context, int pressure) {
+	context->hits->push({context->now, HIT_AFTERTOUCH, (uint8_t) id, (uint8_t) p.headNote, (uint8_t) pressure, 0});
+
+	if (p.rimNote != p.headNote) {
+		context->hits->push({context->now, HIT_AFTERTOUCH, (uint8_t) id, (uint8_t) p.rimNote, (uint8_t) pressure, 0});
+	}
+}
+
+
+//
+//	Pad::processPedal
+//
+//	The pedal sensor (the rim sensor of a hi-hat) gives a position instead of
+//	hits. The rim threshold and sensitivity hold the readings (in 1/8 of the
+//	ADC range) of the open and closed pedal.
+//
+
+static int pedalVelocity(int speed) {
+	// full travel speeds in positions per reading (8.8 fixed point)
+	const int slow = (127 << 8) * 1000 / (HIHAT_SLOW_TIME * HIHAT_RATE);
+	const int fast = (127 << 8) * 1000 / (HIHAT_FAST_TIME * HIHAT_RATE);
+
+	if (speed < slow) {
+		return 0;
+
+	} else if (speed >= fast) {
+		return 127;
+
+	} else {
+		return 1 + ((speed - slow) * 126) / (fast - slow);
+	}
+}
+
+void Pad::processPedal(Context* context) {
+	// smooth the reading (filter runs in 8.8 fixed point, raw << 5 is raw / 8 << 8)
+	int raw = context->scanner->getValue(p.rimSensor) + context->scanner->getOffset(p.rimSensor);
+	pedalReading += ((raw << 5) - pedalReading) >> HIHAT_FILTER_SHIFT;
+
+	// scale to a position between open and closed
+	int range = p.rimSensitivity - p.rimThreshold;
+	int position = range ? ((pedalReading - (p.rimThreshold << 8)) * 127) / range : pedalReading;
+	position = position < 0 ? 0 : (position > (127 << 8) ? 127 << 8 : position);
+
+	int speed = position - pedalPosition;
+	pedalPosition = position;
+
+	// closing the pedal fast enough chicks, opening it again right after splashes
+	if (!pedalClosed) {
+		pedalSpeed = speed > pedalSpeed ? speed : (speed > 0 ? pedalSpeed : 0);
+
+		if (position >= HIHAT_CLOSED << 8) {
+			pedalClosed = true;
+			pedalClosedTime = context->now;
+			int velocity = pedalVelocity(pedalSpeed);
+
+			if (velocity) {
+				context->hits->push({context->now, HIT_NOTE, (uint8_t) id, HIHAT_CHICK_NOTE, (uint8_t) velocity, (uint8_t) p.gateTime});
+			}
 		}
+
+	} else if (position < (HIHAT_CLOSED - HIHAT_HYSTERESIS) << 8) {
+		pedalClosed = false;
+		pedalSpeed = 0;
+		int velocity = pedalVelocity(-speed);
+
+		if (velocity && context->now - pedalClosedTime < HIHAT_SPLASH_TIME * (SAMPLING_RATE / 1000)) {
+			context->hits->push({context->now, HIT_NOTE, (uint8_t) id, HIHAT_SPLASH_NOTE, (uint8_t) velocity, (uint8_t) p.gateTime});
+		}
+	}
+
+	// send the position when it leaves the hysteresis band (or reaches an end), but not too often
+	// (rounded, the filter settles a little below a rising reading and would never reach closed)
+	int value = (position + 128) >> 8;
+	int change = value > pedalValue ? value - pedalValue : pedalValue - value;
+
+	if ((change >= HIHAT_HYSTERESIS || (change && (value == 0 || value == 127))) &&
+		context->now - pedalTime >= HIHAT_INTERVAL * (SAMPLING_RATE / 1000)) {
+		context->hits->push({context->now, HIT_CONTROL, (uint8_t) id, 4, (uint8_t) value, 0});
+		pedalValue = value;
+		pedalTime = context->now;
 	}
 }
 
@@ -155,5 +613,54 @@ void Pad::process(Context* context) {
 //
 
 void Pad::sendAsMidi() {
-	p.sendAsMidi(MIDI_SEND_PAD, id);
+	// the background's copy (detection may be switching to it)
+	received.sendAsMidi(MIDI_SEND_PAD, id);
+}
+
+
+//
+//	Pad::receiveFromMidi
+//
+
+bool Pad::receiveFromMidi(uint8_t* data, unsigned int size) {
+	if (received.receiveFromMidi(data, size)) {
+		prepare();
+		return true;
+
+	} else {
+		return false;
+	}
+}
+
+
+//
+//	Pad::getSensors
+//
+
+uint32_t Pad::getSensors() {
+	uint32_t sensors = 0;
+
+	if (p.headSensor >= 1 && p.headSensor <= NUMBER_OF_SENSORS) {
+		sensors |= 1u << (p.headSensor - 1);
+	}
+
+	if (p.zones != SINGLE_ZONE && p.rimSensor >= 1 && p.rimSensor <= NUMBER_OF_SENSORS) {
+		sensors |= 1u << (p.rimSensor - 1);
+	}
+
+	return sensors;
+}
+
+
+//
+//	Pad::getPedal
+//
+
+uint32_t Pad::getPedal() {
+	if (p.zones == HIHAT && p.rimSensor >= 1 && p.rimSensor <= NUMBER_OF_SENSORS) {
+		return 1u << (p.rimSensor - 1);
+
+	} else {
+		return 0;
+	}
 }
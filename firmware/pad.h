@@ -12,11 +12,110 @@
 //	Include files
 //
 
+#include <stdint.h>
+
+#include "config.h"
 #include "context.h"
+#include "crosstalk.h"
 #include "curve.h"
 #include "properties.h"
 
 
+//
+//	Pad trigger states
+//
+
+enum {
+	IDLE,
+	SCANNING,
+	MASK,
+	RETRIGGER,
+	CHOKE
+};
+
+
+//
+//	Pad state for all pads (structure of arrays)
+//
+//	The kit needs the sensors and thresholds of every pad to build its
+//	per sensor trigger levels, so these are kept together in contiguous
+//	arrays with the trigger state instead of in the pad objects. Pads with
+//	an invalid head sensor (or without a rim) get a threshold they can't
+//	reach.
+//
+
+struct PadStates {
+	// trigger settings (head sensor is an index into the frame)
+	int headSensor[PAD_COUNT];
+	int headThreshold[PAD_COUNT];
+	int rimSensor[PAD_COUNT];
+	int rimThreshold[PAD_COUNT];
+	uint8_t headState[PAD_COUNT];
+
+	// hit tracking (times are in sample ticks, velocities hold the peaks of the
+	// current or last hit, the gain scales them to the estimated final peak
+	// when sent early)
+	int headVelocity[PAD_COUNT];
+	int rimVelocity[PAD_COUNT];
+	int headGain[PAD_COUNT];
+	bool headPredicted[PAD_COUNT];
+	unsigned long headStateStartTime[PAD_COUNT];
+	unsigned long headStateDuration[PAD_COUNT];
+	unsigned long headHitTime[PAD_COUNT];
+	unsigned long headPeakTime[PAD_COUNT];
+	unsigned long headZeroCrossingTime[PAD_COUNT];
+
+	// times at which head and rim crossed their thresholds (0 if they didn't)
+	unsigned long headArrivalTime[PAD_COUNT];
+	unsigned long rimArrivalTime[PAD_COUNT];
+
+	// level a new hit must exceed during retrigger (24.8 fixed point velocity)
+	uint32_t headEnvelope[PAD_COUNT];
+
+	// choke tracking of ringing cymbals (ticks of continuous edge contact
+	// and the level at which it started)
+	int headContact[PAD_COUNT];
+	int headContactLevel[PAD_COUNT];
+	bool headChoked[PAD_COUNT];
+};
+
+
+//
+//	Sensor state for the current frame (shared by all pads)
+//
+//	Rectified values and peaks are packed 16 bit so the kit can update them
+//	for all sensors at once with the kernels in dsp.h. Pads reset the peak of
+//	their sensor at the start of a hit.
+//
+
+struct SensorStates {
+	alignas(16) int16_t rectified[NUMBER_OF_SENSORS];
+	alignas(16) int16_t peaks[NUMBER_OF_SENSORS];
+
+	// trigger level (lowest raw threshold of the pads using the sensor)
+	alignas(16) int16_t thresholds[NUMBER_OF_SENSORS];
+
+	// pads using the sensor as head or rim sensor (bitmask, pad 1 is bit 0)
+	uint32_t pads[NUMBER_OF_SENSORS];
+};
+
+
+//
+//	Velocity maps
+//
+//	Threshold, sensitivity and curve are merged into one table per zone that
+//	maps a peak (in rectified >> 2 units) straight to a midi velocity. Peaks
+//	above the table are clamped as all settings fit in a byte.
+//
+
+#define VELOCITY_MAP_SIZE 256
+
+struct VelocityMap {
+	uint8_t head[VELOCITY_MAP_SIZE];
+	uint8_t rim[VELOCITY_MAP_SIZE];
+};
+
+
 //
 //	Generic Pad class
 //
@@ -30,28 +129,110 @@ public:
 	int saveSettings(int offset);
 	int loadSettings(int offset);
 
-	// process next sample
-	void process(Context* context);
+	// copy settings required by the idle pass into the state arrays
+	void configure(PadStates& s);
+
+	// process next sample (state is kept in the kit's state arrays)
+	// returns true when a scan window ended and the hit can be sent
+	bool process(Context* context, PadStates& s, SensorStates& sensors);
 
-	// send pad configuration over midi
+	// send notes for a finished hit (after removing bleed from other pads)
+	void sendHit(Context* context, PadStates& s, Crosstalk& crosstalk);
+
+	// send/receive pad configuration over midi (in the background, a received
+	// configuration is prepared next to the active one)
 	void sendAsMidi();
+	bool receiveFromMidi(uint8_t* data, unsigned int size);
+
+	// switch to the configuration prepared by receiveFromMidi (in detection)
+	void update();
+
+	// get bitmask of sensors used by this pad (sensor 1 is bit 0)
+	uint32_t getSensors();
+
+	// get bitmask of the hi-hat pedal sensor (0 if the pad has no pedal)
+	uint32_t getPedal();
+
+	// process next pedal reading (called every SAMPLING_RATE / HIHAT_RATE frames)
+	void processPedal(Context* context);
+
+	// get the velocity a peak (in rectified >> 2 units) maps to on the head or rim
+	inline int getVelocity(int peak, bool rim) {
+		const VelocityMap& velocityMap = maps[map];
+		return (rim ? velocityMap.rim : velocityMap.head)[peak < VELOCITY_MAP_SIZE ? peak : VELOCITY_MAP_SIZE - 1];
+	}
 
 private:
+	// build the velocity maps and retrigger decay of the received properties
+	// in the inactive slots (the slow part of a configuration change)
+	void prepare();
+	void buildVelocityMap(uint8_t* map, int threshold, int sensitivity);
+
+	// map a peak to a midi velocity and queue the note
+	void sendNote(Context* context, int note, int velocity, const uint8_t* map);
+
+	// estimate the final peak before the scan window ends (returns true when sent)
+	bool predict(Context* context, PadStates& s, int velocity);
+
+	// learn from the full window peak of a hit that was sent early
+	void learn(PadStates& s);
+
+	// estimate strike position (0 is centre, 127 edge) from the timing of a finished hit
+	int estimatePosition(PadStates& s);
+
+	// queue choke (pressure 127) or release (pressure 0) as aftertouch on the pad's notes
+	void sendChoke(Context* context, int pressure);
+
 	// pad ID
 	int id;
 
-	// pad properties
+	// pad properties (used by detection) and the ones last received (owned by
+	// the background, they become active with update())
 	Properties p;
+	Properties received;
 
 	// current curve
 	Curve curve;
 
-	// scanning parameters
-	int headState;
-	int headVelocity;
-	unsigned long headStateStartTime;
-	unsigned long headStateDuration;
-	unsigned long headHitTime;
-	unsigned long headPeakTime;
-	unsigned long headZeroCrossingTime;
+	// durations in sample ticks
+	unsigned long scanTicks;
+	unsigned long maskTicks;
+	unsigned long retriggerTicks;
+	unsigned long predictTicks;
+
+	// per tick decay of the retrigger level (0.16 fixed point, active and prepared)
+	uint32_t retriggerDecay;
+	uint32_t receivedDecay;
+
+	// cymbal that rings after a hit and can be choked (set by the pad type)
+	bool choke;
+
+	// velocity maps (a new map is built in the inactive one and swapped in by update())
+	VelocityMap maps[2];
+	volatile int map = 0;
+
+	// first lobe of the current hit (peak and ticks from the start of the hit)
+	int lobePeak = 0;
+	unsigned long lobeTime = 0;
+
+	// learned ratio of final peak to first lobe peak (1/256 units) and rise time (in ticks)
+	int lobeGain = 256;
+	unsigned long riseTime = 0;
+
+	// learned strike timings of centre and edge hits (in ticks, 28.4 fixed point)
+	int positionCentre = 0;
+	int positionEdge = 0;
+
+	// hi-hat pedal reading and position (0 is open, 127 closed, both 8.8 fixed point)
+	int pedalReading = 0;
+	int pedalPosition = 0;
+
+	// fastest closing speed of the current pedal stroke (positions per reading, 8.8 fixed point)
+	int pedalSpeed = 0;
+
+	// pedal state (closed and when it closed, last position sent and when)
+	bool pedalClosed = false;
+	unsigned long pedalClosedTime = 0;
+	int pedalValue = -1;
+	unsigned long pedalTime = 0;
 };
@@ -35,6 +35,9 @@ Properties::Properties() {
 	scanTime = 3;
 	maskTime = 5;
 	retriggerTime = 40;
+	predictTime = 0;
+	gateTime = 0;
+	positionControl = 0;
 	curve = CURVE_LOUD1;
 
 	headSensor = 1;
@@ -63,6 +66,9 @@ Properties::Properties(int t, int z, const char* n, int st, int mt, int rt, int
 	scanTime = st;
 	maskTime = mt;
 	retriggerTime = rt;
+	predictTime = 0;
+	gateTime = 0;
+	positionControl = 0;
 	curve = c;
 
 	headSensor = hs;
@@ -92,6 +98,9 @@ int Properties::saveSettings(int offset) {
 	EEPROM.update(offset++, scanTime);
 	EEPROM.update(offset++, maskTime);
 	EEPROM.update(offset++, retriggerTime);
+	EEPROM.update(offset++, predictTime);
+	EEPROM.update(offset++, gateTime);
+	EEPROM.update(offset++, positionControl);
 	EEPROM.update(offset++, curve);
 
 	EEPROM.update(offset++, headSensor);
@@ -123,6 +132,10 @@ int Properties::loadSettings(int offset) {
 	scanTime = EEPROM.read(offset++);
 	maskTime = EEPROM.read(offset++);
 	retriggerTime = EEPROM.read(offset++);
+	predictTime = EEPROM.read(offset++);
+	gateTime = EEPROM.read(offset++);
+	gateTime = gateTime > MAX_GATE_TIME ? MAX_GATE_TIME : gateTime;
+	positionControl = EEPROM.read(offset++);
 	curve = EEPROM.read(offset++);
 
 	headSensor = EEPROM.read(offset++);
@@ -158,6 +171,9 @@ void Properties::sendAsMidi(int command, int id) {
 		uint8_t scanTime;
 		uint8_t maskTime;
 		uint8_t retriggerTime;
+		uint8_t predictTime;
+		uint8_t gateTime;
+		uint8_t positionControl;
 		uint8_t curve;
 
 		uint8_t headSensor;
@@ -186,6 +202,9 @@ void Properties::sendAsMidi(int command, int id) {
 	msg.scanTime = scanTime;
 	msg.maskTime = maskTime;
 	msg.retriggerTime = retriggerTime;
+	msg.predictTime = predictTime;
+	msg.gateTime = gateTime;
+	msg.positionControl = positionControl;
 	msg.curve = curve;
 
 	msg.headSensor = headSensor;
@@ -203,3 +222,48 @@ void Properties::sendAsMidi(int command, int id) {
 	// send message
 	usbMIDI.sendSysEx(sizeof(msg), (uint8_t*) &msg, true);
 }
+
+
+//
+//	Properties::receiveFromMidi
+//
+
+bool Properties::receiveFromMidi(uint8_t* data, unsigned int size) {
+	// ensure message is complete (header, id, fields and end)
+	if (size < 4 + 2 + sizeof(name) + 15 + 1) {
+		return false;
+	}
+
+	// skip header and id
+	data += 4;
+
+	// extract fields (same layout as sendAsMidi)
+	type = *data++;
+	zones = *data++;
+
+	for (size_t i = 0; i < sizeof(name); i++) {
+		name[i] = *data++;
+	}
+
+	name[sizeof(name) - 1] = 0;
+
+	scanTime = *data++;
+	maskTime = *data++;
+	retriggerTime = *data++;
+	predictTime = *data++;
+	gateTime = *data++;
+	positionControl = *data++;
+	curve = *data++;
+
+	headSensor = *data++;
+	headSensitivity = *data++;
+	headThreshold = *data++;
+	headNote = *data++;
+
+	rimSensor = *data++;
+	rimSensitivity = *data++;
+	rimThreshold = *data++;
+	rimNote = *data++;
+
+	return true;
+}
@@ -8,6 +8,13 @@
 #pragma once
 
 
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+
 //
 //	Pad properties class
 //
@@ -21,8 +28,9 @@ struct Properties {
 	int saveSettings(int offset);
 	int loadSettings(int offset);
 
-	// send properties as midi message
+	// send/receive properties as midi message
 	void sendAsMidi(int command, int number);
+	bool receiveFromMidi(uint8_t* data, unsigned int size);
 
 	// properties
 	int type;
@@ -32,6 +40,9 @@ struct Properties {
 	int scanTime;
 	int maskTime;
 	int retriggerTime;
+	int predictTime;
+	int gateTime;
+	int positionControl;
 	int curve;
 
 	int headSensor;
@@ -39,6 +50,9 @@ struct Properties {
 	int headThreshold;
 	int headNote;
 
+	// (on a hi-hat the rim sensor is the pedal, and its sensitivity and
+	// threshold are the readings of the closed and open pedal in 1/8 of the
+	// ADC range)
 	int rimSensor;
 	int rimSensitivity;
 	int rimThreshold;
@@ -0,0 +1,69 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <atomic>
+
+
+//
+//	Single producer/single consumer queue
+//
+//	Passes items between two contexts without locks: only the producer moves
+//	the tail and only the consumer moves the head. Both run free as unsigned
+//	counters, so a full queue is told apart from an empty one without wasting
+//	a slot. A push to a full queue drops the item and counts an overrun.
+//
+
+template <typename T, unsigned int SIZE>
+class Queue {
+	static_assert((SIZE & (SIZE - 1)) == 0, "Queue size must be a power of two");
+
+public:
+	// add an item (producer side, returns false if the queue was full)
+	bool push(const T& item) {
+		unsigned int t = tail.load(std::memory_order_relaxed);
+
+		if (t - head.load(std::memory_order_acquire) == SIZE) {
+			overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		items[t & (SIZE - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// remove the oldest item (consumer side, returns false if the queue was empty)
+	bool pop(T& item) {
+		unsigned int h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		item = items[h & (SIZE - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// get number of items that were dropped because the queue was full
+	inline unsigned int getOverruns() {
+		return overruns.load(std::memory_order_relaxed);
+	}
+
+private:
+	T items[SIZE];
+	std::atomic<unsigned int> head{0};
+	std::atomic<unsigned int> tail{0};
+	std::atomic<unsigned int> overruns{0};
+};
@@ -9,60 +9,127 @@
 //	Include files
 //
 
+#include <string.h>
+
 #include "scanner.h"
 
 
+//
+//	Full scan schedule
+//
+//	Mux addresses are visited in Gray code order {0, 1, 3, 2, 6, 7, 5, 4}
+//	so only one address line changes between positions. Both ADC pairs are
+//	converted at each position before the mux moves on.
+//
+
+static const ScanStep fullSchedule[SCAN_STEPS] = {
+	{0, 0}, {0, 1},
+	{1, 0}, {1, 1},
+	{3, 0}, {3, 1},
+	{2, 0}, {2, 1},
+	{6, 0}, {6, 1},
+	{7, 0}, {7, 1},
+	{5, 0}, {5, 1},
+	{4, 0}, {4, 1}
+};
+
+
 //
 //	Scanner::Scanner
 //
 
 Scanner::Scanner() {
-	// disable KEEPER on analog pins
-	int mask = ~(1 << 12);
-	CORE_PIN14_PADCONFIG &= mask; // A0
-	CORE_PIN15_PADCONFIG &= mask; // A1
-	CORE_PIN16_PADCONFIG &= mask; // A2
-	CORE_PIN17_PADCONFIG &= mask; // A3
-	CORE_PIN18_PADCONFIG &= mask; // A4
-	CORE_PIN19_PADCONFIG &= mask; // A5
+	// scan all sensors until users tell us otherwise
+	compile(schedules[0], ~0);
 
-	// configure ADCs
-	adc.adc0->setResolution(10);
-	adc.adc0->setAveraging(1);
-	adc.adc0->setConversionSpeed(ADC_CONVERSION_SPEED::VERY_HIGH_SPEED);
-	adc.adc0->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_HIGH_SPEED);
+	// setup hardware
+	begin();
 
-	adc.adc1->setResolution(10);
-	adc.adc1->setAveraging(1);
-	adc.adc1->setConversionSpeed(ADC_CONVERSION_SPEED::VERY_HIGH_SPEED);
-	adc.adc1->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_HIGH_SPEED);
+	// calibrate scanner by determining initial DC offsets
+	calibrate();
+}
 
-	// configure mux addressing
-	pinMode(MUX_A1, OUTPUT); digitalWriteFast(MUX_A1, LOW);
-	pinMode(MUX_A2, OUTPUT); digitalWriteFast(MUX_A2, LOW);
-	pinMode(MUX_A3, OUTPUT); digitalWriteFast(MUX_A3, LOW);
 
-	// calibrate scanner by determining DC offsets
-	calibrate();
+//
+//	Scanner::start
+//
+
+void Scanner::start() {
+	// every call is a sample tick, even when the frame is skipped
+	ticks++;
+
+	// previous frame is still being converted, skip this one
+	if (busy) {
+		overruns++;
+		return;
+	}
+
+	// switch to new schedule (if required, the acquire pairs with the release
+	// in useSensors so the compiled steps are seen before the flag)
+	if (pending.load(std::memory_order_acquire)) {
+		schedule = schedule ^ 1;
+		pending.store(false, std::memory_order_relaxed);
+	}
+
+	// start at the top of the schedule
+	busy = true;
+	step = 0;
+	fillingTime = ticks;
+
+	if (schedules[schedule].count) {
+		convert(schedules[schedule].steps[0]);
+
+	} else {
+		finish();
+	}
 }
 
 
 //
-//	Helper macros for optimize readability and performance
+//	Scanner::complete
 //
 
-#define READ_PORT(pin1, pin2, addr1, addr2, port)							\
-	adc.startSynchronizedSingleRead(pin1, pin2);							\
-	while (adc.adc0->isConverting() || adc.adc1->isConverting());			\
-																			\
-	next[addr1 + port] = adc.adc0->readSingle() - offsets[addr1 + port];	\
-	next[addr2 + port] = adc.adc1->readSingle() - offsets[addr2 + port];
+void Scanner::complete(int value1, int value2) {
+	// store values in the frame being filled
+	const ScanSchedule& active = schedules[schedule];
+	const ScanStep& s = active.steps[step];
+	int sensor1 = s.pair * 16 + s.address;
+	int sensor2 = sensor1 + 8;
 
-#define READ_PORTS(mux, level, port)										\
-	digitalWriteFast(mux, level);											\
-	delayMicroseconds(MUX_SWITCH_DELAY);									\
-	READ_PORT(A0, A1,  0,  8, port)											\
-	READ_PORT(A2, A3, 16, 24, port)
+	int16_t* frame = frames[filling];
+	frame[sensor1] = value1 - offsets[sensor1];
+	frame[sensor2] = value2 - offsets[sensor2];
+
+	// chain next conversion or hand off completed frame
+	if (++step < active.count) {
+		convert(active.steps[step]);
+
+	} else {
+		finish();
+	}
+}
+
+
+//
+//	Scanner::finish
+//
+
+void Scanner::finish() {
+	// previous frame was never picked up
+	if (ready) {
+		overruns++;
+	}
+
+	latest = filling;
+	latestTime = fillingTime;
+	filling = (filling + 1) & (SCANNER_HISTORY - 1);
+	busy = false;
+	ready = true;
+
+	if (frameHandler) {
+		frameHandler();
+	}
+}
 
 
 //
@@ -70,20 +137,10 @@ Scanner::Scanner() {
 //
 
 void Scanner::read() {
-	// start next scanning cycle
-	memcpy(previous, current, sizeof(current));
-	memcpy(current, next, sizeof(current));
-
-	// unroll mux loop to minimize address changes
-	// {0, 1, 3, 2, 6, 7, 5, 4}
-	READ_PORTS(MUX_A1, LOW, 0);
-	READ_PORTS(MUX_A3, HIGH, 1);
-	READ_PORTS(MUX_A2, HIGH, 3);
-	READ_PORTS(MUX_A3, LOW, 2);
-	READ_PORTS(MUX_A1, HIGH, 6);
-	READ_PORTS(MUX_A3, HIGH, 7);
-	READ_PORTS(MUX_A2, LOW, 5);
-	READ_PORTS(MUX_A3, LOW, 4);
+	// advance history (frames stay where they were converted)
+	head = latest;
+	time = latestTime;
+	ready = false;
 }
 
 
@@ -94,19 +151,208 @@ void Scanner::read() {
 void Scanner::calibrate() {
 	// sum of readings to calculate DC offset
 	int sum[NUMBER_OF_SENSORS] = {0};
+	memset(offsets, 0, sizeof(offsets));
 
-	// get enough readings to determine offsets
-	for (auto i = 0; i < 1000; i++) {
+	// get a short run of readings to seed the baselines (tracking does the rest)
+	for (auto i = 0; i < CALIBRATION_FRAMES; i++) {
 		// read values and update sums
+		start();
+
+		while (!available()) {
+		}
+
 		read();
 
 		for (auto s = 0; s < NUMBER_OF_SENSORS; s++) {
-			sum[s] += next[s];
+			sum[s] += getValue(s + 1);
 		}
 	}
 
 	// determine offsets by calculating avarage
 	for (auto s = 0; s < NUMBER_OF_SENSORS; s++) {
-		offsets[s] = sum[s] / 1000;
+		baselines[s] = (int32_t) (((int64_t) sum[s] << 16) / CALIBRATION_FRAMES);
+		offsets[s] = baselines[s] >> 16;
+	}
+}
+
+
+//
+//	Scanner::track
+//
+//	Leaky integrator per sensor: baseline += (raw - baseline) / 2^BASELINE_SHIFT.
+//	The current value already has the integer offset removed, so only the
+//	fractional part of the baseline has to be corrected. The loop is branch
+//	free (idle sensors are selected by multiplying with their mask bit) so
+//	the compiler can vectorize it.
+//
+
+void Scanner::track(uint32_t idle) {
+	// sensors that aren't scanned hold stale values
+	idle &= schedules[schedule].sensors;
+	int16_t* frame = frames[head];
+
+	for (auto s = 0; s < NUMBER_OF_SENSORS; s++) {
+		int32_t difference = frame[s] * 65536 - (baselines[s] & 0xffff);
+		baselines[s] += (difference >> BASELINE_SHIFT) * (int32_t) ((idle >> s) & 1);
+		offsets[s] = baselines[s] >> 16;
+	}
+}
+
+
+//
+//	Scanner::useSensors
+//
+
+void Scanner::useSensors(int user, uint32_t sensors) {
+	users[user] = sensors;
+
+	// determine all sensors in use
+	uint32_t active = 0;
+
+	for (auto i = 0; i < SCANNER_USERS; i++) {
+		active |= users[i];
+	}
+
+	// nothing to do if the active schedule already covers this
+	if (!pending.load(std::memory_order_relaxed) && active == schedules[schedule].sensors) {
+		return;
+	}
+
+	// withdraw pending schedule (acquisition only switches when this is set),
+	// keep the compile from being moved ahead of that and publish the new
+	// schedule in the slot that is not in use
+	pending.store(false, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	compile(schedules[schedule ^ 1], active);
+	pending.store(true, std::memory_order_release);
+}
+
+
+//
+//	Scanner::compile
+//
+
+void Scanner::compile(ScanSchedule& target, uint32_t sensors) {
+	target.count = 0;
+	target.sensors = sensors;
+
+	// keep steps that convert at least one active sensor (in Gray code order)
+	for (auto i = 0; i < SCAN_STEPS; i++) {
+		const ScanStep& step = fullSchedule[i];
+		int sensor = step.pair * 16 + step.address;
+
+		if (sensors & ((1u << sensor) | (1u << (sensor + 8)))) {
+			target.steps[target.count++] = step;
+		}
 	}
 }
+
+
+//
+//	Teensy hardware layer (host builds provide their own)
+//
+
+#if defined(ARDUINO)
+
+#include <ADC.h>
+
+
+//
+//	Hardware state
+//
+
+static ADC* adc;
+static Scanner* instance;
+static int address = 0;
+
+
+//
+//	ADC conversion complete interrupt
+//
+
+static void conversionComplete() {
+	// both ADCs were started together from the same trigger and run at the
+	// same speed, so the second one is done (or a few cycles away) by the
+	// time the first one interrupts; this loop hardly ever spins
+	while (adc->adc1->isConverting());
+
+	ADC::Sync_result result = adc->readSynchronizedSingle();
+	instance->complete(result.result_adc0, result.result_adc1);
+}
+
+
+//
+//	Scanner::begin
+//
+
+void Scanner::begin() {
+	instance = this;
+	adc = new ADC();
+
+	// disable KEEPER on analog pins
+	int mask = ~(1 << 12);
+	CORE_PIN14_PADCONFIG &= mask; // A0
+	CORE_PIN15_PADCONFIG &= mask; // A1
+	CORE_PIN16_PADCONFIG &= mask; // A2
+	CORE_PIN17_PADCONFIG &= mask; // A3
+	CORE_PIN18_PADCONFIG &= mask; // A4
+	CORE_PIN19_PADCONFIG &= mask; // A5
+
+	// configure ADCs
+	adc->adc0->setResolution(10);
+	adc->adc0->setAveraging(1);
+	adc->adc0->setConversionSpeed(ADC_CONVERSION_SPEED::VERY_HIGH_SPEED);
+	adc->adc0->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_HIGH_SPEED);
+
+	adc->adc1->setResolution(10);
+	adc->adc1->setAveraging(1);
+	adc->adc1->setConversionSpeed(ADC_CONVERSION_SPEED::VERY_HIGH_SPEED);
+	adc->adc1->setSamplingSpeed(ADC_SAMPLING_SPEED::VERY_HIGH_SPEED);
+
+	// chain conversions from the completion interrupt (just below the scan
+	// timer at 128 and above detection at 208, the library default of 255
+	// would let detection hold up acquisition)
+	adc->adc0->enableInterrupts(conversionComplete, 144);
+
+	// configure mux addressing
+	pinMode(MUX_A1, OUTPUT); digitalWriteFast(MUX_A1, LOW);
+	pinMode(MUX_A2, OUTPUT); digitalWriteFast(MUX_A2, LOW);
+	pinMode(MUX_A3, OUTPUT); digitalWriteFast(MUX_A3, LOW);
+}
+
+
+//
+//	Scanner::convert
+//
+//	Called from the timer (first step) and the conversion complete interrupt
+//	(next steps), so the mux settle time is spent at interrupt level. The
+//	Gray code order limits that to one switch per address: at most 8 times
+//	MUX_SWITCH_DELAY (8us) of a 50us sample tick, while the conversions
+//	themselves take about 16us. A one-shot timer per switch would cost
+//	about as much in interrupt entry and exit as the 1us it saves, and
+//	detection (the only other work in a tick) runs at a lower priority and
+//	simply gets the rest of the tick.
+//
+
+void Scanner::convert(const ScanStep& step) {
+	// switch mux address lines that changed and let the mux settle
+	int changed = address ^ step.address;
+
+	if (changed) {
+		if (changed & 1) digitalWriteFast(MUX_A3, step.address & 1 ? HIGH : LOW);
+		if (changed & 2) digitalWriteFast(MUX_A2, step.address & 2 ? HIGH : LOW);
+		if (changed & 4) digitalWriteFast(MUX_A1, step.address & 4 ? HIGH : LOW);
+		address = step.address;
+		delayMicroseconds(MUX_SWITCH_DELAY);
+	}
+
+	// start conversion on selected input pair
+	if (step.pair) {
+		adc->startSynchronizedSingleRead(A2, A3);
+
+	} else {
+		adc->startSynchronizedSingleRead(A0, A1);
+	}
+}
+
+#endif
@@ -12,45 +12,170 @@
 //	Include files
 //
 
-#include <ADC.h>
+#include <stdint.h>
+
+#include <atomic>
 
 #include "config.h"
 
 
+//
+//	Scan schedule step
+//
+//	Each step selects a mux address (shared by all sensor boards) and
+//	converts one ADC input pair. Pair 0 reads sensors (address, address + 8)
+//	and pair 1 reads sensors (address + 16, address + 24).
+//
+
+struct ScanStep {
+	uint8_t address;
+	uint8_t pair;
+};
+
+#define SCAN_STEPS 16
+
+
+//
+//	Scan schedule (only contains steps for active sensors)
+//
+
+struct ScanSchedule {
+	ScanStep steps[SCAN_STEPS];
+	int count;
+	uint32_t sensors;
+};
+
+
+//
+//	Scanner users (each can request its own set of sensors)
+//
+
+enum {
+	SCANNER_KIT,
+	SCANNER_OSCILLOSCOPE,
+	SCANNER_USERS
+};
+
+static_assert((SCANNER_HISTORY & (SCANNER_HISTORY - 1)) == 0, "SCANNER_HISTORY must be a power of two");
+static_assert(SCANNER_HISTORY >= 2, "SCANNER_HISTORY must be at least 2");
+
+
 //
 //	Scanner class to read sensor inputs
 //
+//	Frames are acquired in the background: the scan timer calls start(), each
+//	completed conversion calls complete() which chains the next step of the
+//	schedule. Frames are stored in a ring of SCANNER_HISTORY buffers so the
+//	kit can process one frame while the next one is being converted and
+//	older frames stay available without copying. The slot being filled is
+//	the oldest one, so valid ages are 0 to SCANNER_HISTORY - 2.
+//
+//	Only sensors requested by one of the users are converted. When that set
+//	changes, a new schedule is compiled into the spare slot and picked up at
+//	the start of the next frame, so it is safe to do while scanning.
+//
 
 class Scanner {
 public:
 	// constructor
 	Scanner();
 
-	// determine DC offset
+	// determine initial DC offsets
 	void calibrate();
 
-	// read all inputs
+	// update DC offsets for sensors that are idle (bitmask, sensor 1 is bit 0)
+	void track(uint32_t idle);
+
+	// specify sensors required by a user (bitmask, sensor 1 is bit 0)
+	void useSensors(int user, uint32_t sensors);
+
+	// set function to call when a frame is complete (called from ADC interrupt)
+	inline void setFrameHandler(void (*handler)()) {
+		frameHandler = handler;
+	}
+
+	// start acquisition of the next frame (called from scan timer)
+	void start();
+
+	// handle a completed conversion (called from ADC interrupt)
+	void complete(int value1, int value2);
+
+	// see if a new frame is available
+	inline bool available() {
+		return ready;
+	}
+
+	// make the latest frame the current one
 	void read();
 
-	// get current value
-	inline int getValue(int sensor) {
-		return current[sensor - 1];
+	// get value (age 0 is the current frame, 1 the previous one, etc.)
+	inline int getValue(int sensor, int age=0) {
+		return frames[(head - age) & (SCANNER_HISTORY - 1)][sensor - 1];
 	}
 
-	// get previous value
-	inline int getPrevious(int sensor) {
-		return previous[sensor - 1];
+	// get DC offset that was removed from a sensor's values
+	inline int getOffset(int sensor) {
+		return offsets[sensor - 1];
 	}
 
-private:
-	// analog/digital convertor
-	ADC adc;
+	// get all values of a frame (indexed by sensor - 1)
+	inline const int16_t* getFrame(int age=0) {
+		return frames[(head - age) & (SCANNER_HISTORY - 1)];
+	}
 
-	// DC offsets
-	int offsets[NUMBER_OF_SENSORS];
+	// get sample tick at which the current frame was started (the kit's clock)
+	inline unsigned long getTime() {
+		return time;
+	}
+
+	// get number of frames that were lost because we couldn't keep up
+	inline unsigned int getOverruns() {
+		return overruns;
+	}
 
-	// values over three scanning periods
-	int previous[NUMBER_OF_SENSORS];
-	int current[NUMBER_OF_SENSORS];
-	int next[NUMBER_OF_SENSORS];
+private:
+	// hardware specific functions
+	void begin();
+	void convert(const ScanStep& step);
+
+	// compile a schedule for a set of sensors
+	void compile(ScanSchedule& target, uint32_t sensors);
+
+	// hand off a completed frame
+	void finish();
+
+	// sensors required by each user
+	uint32_t users[SCANNER_USERS] = {0};
+
+	// active and spare schedule
+	ScanSchedule schedules[2];
+	volatile int schedule = 0;
+	std::atomic<bool> pending{false};
+
+	// DC offsets (baselines are 16.16 fixed point, offsets are their integer part)
+	int32_t baselines[NUMBER_OF_SENSORS] = {0};
+	int offsets[NUMBER_OF_SENSORS] = {0};
+
+	// frame history ring of packed 16 bit samples (head is the current frame)
+	alignas(16) int16_t frames[SCANNER_HISTORY][NUMBER_OF_SENSORS] = {{0}};
+	int head = 0;
+
+	// frame being filled and last completed frame
+	volatile int filling = 1;
+	volatile int latest = 0;
+
+	// sample ticks (scan timer calls) and the ticks at which frames were started
+	volatile unsigned long ticks = 0;
+	volatile unsigned long fillingTime = 0;
+	volatile unsigned long latestTime = 0;
+	unsigned long time = 0;
+
+	// function to call when a frame is complete
+	void (*volatile frameHandler)() = nullptr;
+
+	// acquisition state
+	volatile int step = 0;
+	volatile bool busy = false;
+	volatile bool ready = false;
+	volatile unsigned int overruns = 0;
 };
@@ -0,0 +1,131 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include "scheduler.h"
+
+
+//
+//	Scheduler::Scheduler
+//
+
+Scheduler::Scheduler() {
+	// all events are available and all slots are empty
+	for (auto i = 0; i < SCHEDULER_EVENTS; i++) {
+		events[i].next = i + 1 < SCHEDULER_EVENTS ? i + 1 : NONE;
+	}
+
+	available = 0;
+
+	for (auto i = 0; i < SCHEDULER_SLOTS; i++) {
+		slots[i] = NONE;
+	}
+
+	for (auto i = 0; i < 128; i++) {
+		pending[i] = NONE;
+	}
+}
+
+
+//
+//	Scheduler::schedule
+//
+
+bool Scheduler::schedule(unsigned long due, uint8_t note) {
+	// a later note off replaces the one that is pending
+	note &= 0x7f;
+	cancel(note);
+
+	if (available == NONE) {
+		return false;
+	}
+
+	// take an event from the pool and add it to the slot it is due in
+	uint8_t e = available;
+	available = events[e].next;
+
+	uint8_t& slot = slots[(due / SCHEDULER_RESOLUTION) & (SCHEDULER_SLOTS - 1)];
+	events[e].due = due;
+	events[e].note = note;
+	events[e].next = slot;
+	slot = e;
+	pending[note] = e;
+	return true;
+}
+
+
+//
+//	Scheduler::cancel
+//
+
+bool Scheduler::cancel(uint8_t note) {
+	uint8_t e = pending[note & 0x7f];
+
+	if (e == NONE) {
+		return false;
+	}
+
+	// find the event in the list of its slot, unlink it and return it to the pool
+	uint8_t* link = &slots[(events[e].due / SCHEDULER_RESOLUTION) & (SCHEDULER_SLOTS - 1)];
+
+	while (*link != e) {
+		link = &events[*link].next;
+	}
+
+	*link = events[e].next;
+	events[e].next = available;
+	available = e;
+	pending[note & 0x7f] = NONE;
+	return true;
+}
+
+
+//
+//	Scheduler::next
+//
+
+bool Scheduler::next(unsigned long now, uint8_t& note) {
+	unsigned long target = now / SCHEDULER_RESOLUTION;
+
+	// after a long break, a single turn of the wheel covers everything
+	if (target - current > SCHEDULER_SLOTS) {
+		current = target - SCHEDULER_SLOTS;
+	}
+
+	while (true) {
+		// look for an event that is due in the slot we are in
+		uint8_t* link = &slots[current & (SCHEDULER_SLOTS - 1)];
+
+		while (*link != NONE) {
+			Event& event = events[*link];
+
+			if ((long) (now - event.due) >= 0) {
+				// unlink event and return it to the pool
+				uint8_t e = *link;
+				*link = event.next;
+				event.next = available;
+				available = e;
+
+				note = event.note;
+				pending[note] = NONE;
+				return true;
+			}
+
+			link = &event.next;
+		}
+
+		// stay in the slot of the current time, move on from earlier ones
+		if (current == target) {
+			return false;
+		}
+
+		current++;
+	}
+}
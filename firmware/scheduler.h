@@ -0,0 +1,70 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+#include "config.h"
+
+
+//
+//	Scheduler class
+//
+//	Timing wheel for deferred note offs. Every slot covers SCHEDULER_RESOLUTION
+//	sample ticks and holds a linked list of the events that are due in it.
+//	Events come from a fixed pool, so scheduling is a push onto the list of
+//	the slot and sending is an unlink, both O(1). Slots are visited in order
+//	as time passes, so each slot is looked at once per turn of the wheel
+//	(plus once per call for the slot we are in). A note has at most one
+//	pending note off, so a retriggered note doesn't get cut short by the
+//	note off of the hit before it.
+//
+
+static_assert((SCHEDULER_SLOTS & (SCHEDULER_SLOTS - 1)) == 0, "SCHEDULER_SLOTS must be a power of two");
+static_assert(SCHEDULER_SLOTS > MAX_GATE_TIME, "SCHEDULER_SLOTS must cover the longest gate time");
+static_assert(SCHEDULER_EVENTS < 255, "SCHEDULER_EVENTS must fit in a byte");
+
+class Scheduler {
+public:
+	// constructor
+	Scheduler();
+
+	// schedule a note off at a sample tick (returns false when all events are in use)
+	bool schedule(unsigned long due, uint8_t note);
+
+	// drop the pending note off of a note (returns false when there is none)
+	bool cancel(uint8_t note);
+
+	// get the next note off that is due (returns false when there are none)
+	bool next(unsigned long now, uint8_t& note);
+
+private:
+	// event pool (linked by index, NONE ends a list)
+	static const uint8_t NONE = 0xff;
+
+	struct Event {
+		unsigned long due;
+		uint8_t note;
+		uint8_t next;
+	};
+
+	Event events[SCHEDULER_EVENTS];
+	uint8_t available;
+
+	// first event of each slot and the slot we are in (in units of SCHEDULER_RESOLUTION ticks)
+	uint8_t slots[SCHEDULER_SLOTS];
+	unsigned long current = 0;
+
+	// pending event of each note
+	uint8_t pending[128];
+};
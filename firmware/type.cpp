@@ -41,7 +41,7 @@ Type::Type(int i) : id(i) {
 			break;
 
 		case TYPE_VH12:
-			p = Properties(i, HIHAT, "VH12", 2, 10, 40, CURVE_LINEAR, 0, 80, 5, 48, 0, 80, 5, 48);
+			p = Properties(i, HIHAT, "VH12", 2, 10, 40, CURVE_LINEAR, 0, 80, 5, 46, 0, 100, 10, 42);
 			break;
 
 		case TYPE_CY12H:
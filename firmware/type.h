@@ -45,6 +45,15 @@ enum {
 };
 
 
+//
+//	Cymbals (grabbing the edge chokes them)
+//
+
+inline bool canChoke(int type) {
+	return type == TYPE_CY12H || type == TYPE_CY12C || type == TYPE_CY15R;
+}
+
+
 //
 //	Type class
 //
@@ -0,0 +1,123 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <atomic>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <usb_midi.h>
+
+#include "core.h"
+
+
+//
+//	Globals
+//
+
+usb_serial_class Serial;
+usb_midi_class usbMIDI;
+EEPROMClass EEPROM;
+
+// simulated time (the background thread reads it when contexts run on separate threads)
+static std::atomic<unsigned long> simulatedTime{0};
+
+// simulated timer interrupt and when it fires next
+static void (*timerHandler)() = nullptr;
+static unsigned long timerInterval = 0;
+static unsigned long timerDue = 0;
+
+
+//
+//	Simulated time
+//
+
+unsigned long micros() {
+	return simulatedTime;
+}
+
+void advanceClock(unsigned long microseconds) {
+	unsigned long end = simulatedTime + microseconds;
+
+	// the timer interrupts whatever is taking the time
+	while (timerHandler && (long) (end - timerDue) >= 0) {
+		simulatedTime = timerDue;
+		timerDue += timerInterval;
+		timerHandler();
+	}
+
+	simulatedTime = end;
+}
+
+void resetClock() {
+	simulatedTime = 0;
+	timerDue = timerInterval;
+}
+
+void setTimer(void (*handler)(), unsigned long interval) {
+	timerHandler = handler;
+	timerInterval = interval;
+	timerDue = simulatedTime + interval;
+}
+
+
+//
+//	usb_midi_class::sendNoteOn
+//
+
+void usb_midi_class::sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel) {
+	events.push_back({simulatedTime, MIDI_NOTE_ON, channel, note, velocity});
+}
+
+
+//
+//	usb_midi_class::sendNoteOff
+//
+
+void usb_midi_class::sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel) {
+	events.push_back({simulatedTime, MIDI_NOTE_OFF, channel, note, velocity});
+}
+
+
+//
+//	usb_midi_class::sendAfterTouchPoly
+//
+
+void usb_midi_class::sendAfterTouchPoly(uint8_t note, uint8_t pressure, uint8_t channel) {
+	events.push_back({simulatedTime, MIDI_AFTERTOUCH_POLY, channel, note, pressure});
+}
+
+
+//
+//	usb_midi_class::sendControlChange
+//
+
+void usb_midi_class::sendControlChange(uint8_t control, uint8_t value, uint8_t channel) {
+	events.push_back({simulatedTime, MIDI_CONTROL_CHANGE, channel, control, value});
+}
+
+
+//
+//	usb_midi_class::sendSysEx
+//
+
+void usb_midi_class::sendSysEx(uint32_t length, const uint8_t* data, bool) {
+	// the firmware always sends complete messages (f0 to f7)
+	sysex.emplace_back(data, data + length);
+	sysexBytes += length;
+
+	// wait for the link to take the message (if it is timed)
+	if (linkRate) {
+		linkBytes += length;
+		unsigned long long done = linkBytes * 1000000ull / linkRate;
+		advanceClock((unsigned long) (done - linkTime));
+		linkTime = done;
+	}
+}
@@ -0,0 +1,20 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Simulated time control
+//
+
+void advanceClock(unsigned long microseconds);
+void resetClock();
+
+// call a handler every interval microseconds of simulated time, like a timer
+// interrupt (a null handler stops it)
+void setTimer(void (*handler)(), unsigned long interval);
@@ -0,0 +1,1011 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <Arduino.h>
+#include <usb_midi.h>
+
+#include "arena.h"
+#include "config.h"
+#include "context.h"
+#include "kit.h"
+#include "monitor.h"
+#include "oscilloscope.h"
+#include "output.h"
+#include "packer.h"
+#include "properties.h"
+#include "scanner.h"
+
+#include "core.h"
+#include "replay.h"
+
+
+//
+//	Globals
+//
+
+static Context context;
+static Arena arena;
+static Oscilloscope oscilloscope(&arena);
+static CommandQueue commands;
+static Output output;
+
+// tick of the frame detection is working on (the background's clock)
+static std::atomic<unsigned long> tick{0};
+
+// background passes that sent part of a capture upload and the largest one
+// (tests/upload.cpp checks that uploads don't cost scan ticks)
+static std::atomic<unsigned long> uploadPasses{0};
+static std::atomic<int> largestPass{0};
+
+// shortest replay (in seconds) that gives a meaningful throughput (replays
+// aren't repeated to get there, that would change what the pads learned)
+static const double MINIMUM_TIMING = 0.01;
+
+
+//
+//	Pad settings that can be changed from the command line
+//
+
+static const struct {
+	const char* name;
+	int Properties::* field;
+} settings[] = {
+	{"type", &Properties::type},
+	{"zones", &Properties::zones},
+	{"scanTime", &Properties::scanTime},
+	{"maskTime", &Properties::maskTime},
+	{"retriggerTime", &Properties::retriggerTime},
+	{"predictTime", &Properties::predictTime},
+	{"gateTime", &Properties::gateTime},
+	{"positionControl", &Properties::positionControl},
+	{"curve", &Properties::curve},
+	{"headSensor", &Properties::headSensor},
+	{"headSensitivity", &Properties::headSensitivity},
+	{"headThreshold", &Properties::headThreshold},
+	{"headNote", &Properties::headNote},
+	{"rimSensor", &Properties::rimSensor},
+	{"rimSensitivity", &Properties::rimSensitivity},
+	{"rimThreshold", &Properties::rimThreshold},
+	{"rimNote", &Properties::rimNote}
+};
+
+
+//
+//	Show usage
+//
+
+static void usage() {
+	fprintf(stderr, "Usage: simulator [-f csv|raw|wav] [-c channels] [-p pad:setting=value,...] [-x source:target=ratio] [-r repeats] [-b] [-t [-w]] [-m pad:samples] [-o sensor,...[:setting=value,...]] [-z] [-e] recording\n");
+	fprintf(stderr, "  -f  recording format (default is based on file extension)\n");
+	fprintf(stderr, "  -c  number of interleaved channels in raw recordings (default %d)\n", NUMBER_OF_SENSORS);
+	fprintf(stderr, "  -p  change pad settings (e.g. -p 1:zones=1,rimSensor=17), can be repeated\n");
+	fprintf(stderr, "  -x  suppress bleed from source pad on target pad (ratio in 1/128), can be repeated\n");
+	fprintf(stderr, "  -r  number of timed runs, the fastest one is reported (default 1)\n");
+	fprintf(stderr, "  -b  compare notes with full scan window notes (matched by note, so give pads distinct notes)\n");
+	fprintf(stderr, "  -t  stress the queues by running detection and background on separate threads\n");
+	fprintf(stderr, "  -w  run the detection thread at real time speed (instead of as fast as possible)\n");
+	fprintf(stderr, "  -g  score notes against ground truth (lines of time in ms, note and optionally position 0-127)\n");
+	fprintf(stderr, "  -m  monitor pad with pre-trigger samples (e.g. -m 1:40)\n");
+	fprintf(stderr, "  -o  capture up to 4 sensors with the oscilloscope (e.g. -o 1,2), settings can follow\n");
+	fprintf(stderr, "      (e.g. -o 1,2:trigger=2,edge=1,level=40,pretrigger=200 or -o 1,2:stream=20)\n");
+	fprintf(stderr, "  -z  ask the monitor and oscilloscope for packed captures\n");
+	fprintf(stderr, "  -e  print captured midi events (and monitor and oscilloscope captures)\n");
+}
+
+
+//
+//	Print captured midi events
+//
+
+static void printEvents() {
+	for (auto& event : usbMIDI.events) {
+		const char* type =
+			event.type == MIDI_NOTE_ON ? "note-on" :
+			event.type == MIDI_NOTE_OFF ? "note-off" :
+			event.type == MIDI_AFTERTOUCH_POLY ? "aftertouch" :
+			event.type == MIDI_CONTROL_CHANGE ? "control" : "other";
+
+		printf("%10.3f ms  %-10s  ch %2d  %3d  %3d\n",
+			event.time / 1000.0, type, event.channel, event.data1, event.data2);
+	}
+}
+
+
+//
+//	Decode the samples of a monitor or oscilloscope data message (header is
+//	the number of bytes in front of the samples, returns false if malformed)
+//
+
+static bool decodeData(const std::vector<uint8_t>& msg, size_t header, bool packed, std::vector<int>& values) {
+	size_t offset = (msg[header - 4] << 7) | msg[header - 3];
+	size_t size = (msg[header - 2] << 7) | msg[header - 1];
+
+	if (offset + size > values.size()) {
+		return false;
+	}
+
+	if (packed) {
+		std::vector<int16_t> unpacked(size);
+
+		if (unpack(msg.data() + header, msg.size() - header - 1, unpacked.data(), size) != (int) size) {
+			return false;
+		}
+
+		std::copy(unpacked.begin(), unpacked.end(), values.begin() + offset);
+
+	} else {
+		if (msg.size() < header + size * 2 + 1) {
+			return false;
+		}
+
+		for (size_t i = 0; i < size; i++) {
+			values[offset + i] = ((msg[header + i * 2] << 7) | msg[header + 1 + i * 2]) - 1024;
+		}
+	}
+
+	return true;
+}
+
+
+//
+//	Print captured monitor sessions and oscilloscope captures (decoded from
+//	their sysex messages, returns false if one of them was malformed)
+//
+
+static bool printCaptures() {
+	std::vector<int> values;
+	int pretrigger = 0;
+	bool ok = true;
+
+	// streamed points of each probe (minimum and maximum) and points that went missing
+	std::vector<std::pair<int, int>> streamed[4];
+	int expected = -1;
+	int missing = 0;
+
+	for (auto& msg : usbMIDI.sysex) {
+		if (msg.size() >= 10 && msg[2] == MIDI_MONITOR_START) {
+			values.assign((msg[5] << 7) | msg[6], 0);
+			pretrigger = (msg[7] << 7) | msg[8];
+
+		} else if (msg.size() >= 10 && (msg[2] == MIDI_MONITOR_DATA || msg[2] == MIDI_MONITOR_PACKED)) {
+			ok &= decodeData(msg, 9, msg[2] == MIDI_MONITOR_PACKED, values);
+
+		} else if (msg.size() >= 5 && msg[2] == MIDI_MONITOR_END) {
+			printf("monitor pad %d channel %d: %zu samples (%d pre-trigger):", msg[3], msg[4], values.size(), pretrigger);
+
+			for (auto value : values) {
+				printf(" %d", value);
+			}
+
+			printf("\n");
+
+		} else if (msg.size() >= 9 && msg[2] == MIDI_OSCILLOSCOPE_START) {
+			values.assign((msg[4] << 7) | msg[5], 0);
+			pretrigger = (msg[6] << 7) | msg[7];
+
+		} else if (msg.size() >= 9 && (msg[2] == MIDI_OSCILLOSCOPE_DATA || msg[2] == MIDI_OSCILLOSCOPE_PACKED)) {
+			ok &= decodeData(msg, 8, msg[2] == MIDI_OSCILLOSCOPE_PACKED, values);
+
+		} else if (msg.size() >= 5 && msg[2] == MIDI_OSCILLOSCOPE_END) {
+			printf("oscilloscope probe %d: %zu samples (%d pre-trigger):", msg[3], values.size(), pretrigger);
+
+			for (auto value : values) {
+				printf(" %d", value);
+			}
+
+			printf("\n");
+
+		} else if (msg.size() >= 7 && msg[2] == MIDI_OSCILLOSCOPE_STREAM) {
+			// sequence numbers tell us about points that were dropped
+			int probes = msg[3];
+			int count = msg[5];
+
+			if (expected >= 0) {
+				missing += (msg[4] - expected) & 0x7f;
+			}
+
+			expected = (msg[4] + count) & 0x7f;
+
+			if (!probes || msg.size() != 7 + (size_t) count * 4 * __builtin_popcount(probes)) {
+				ok = false;
+				continue;
+			}
+
+			const uint8_t* v = msg.data() + 6;
+
+			for (auto i = 0; i < count; i++) {
+				for (auto probe = 0; probe < 4; probe++) {
+					if (probes & (1 << probe)) {
+						streamed[probe].emplace_back(((v[0] << 7) | v[1]) - 1024, ((v[2] << 7) | v[3]) - 1024);
+						v += 4;
+					}
+				}
+			}
+		}
+	}
+
+	for (auto probe = 0; probe < 4; probe++) {
+		if (streamed[probe].size()) {
+			printf("oscilloscope stream probe %d: %zu points (%d missing):", probe + 1, streamed[probe].size(), missing);
+
+			for (auto& point : streamed[probe]) {
+				printf(" %d/%d", point.first, point.second);
+			}
+
+			printf("\n");
+		}
+	}
+
+	if (!ok) {
+		fprintf(stderr, "Malformed capture data\n");
+	}
+
+	return ok;
+}
+
+
+//
+//	Apply pad settings (pad:setting=value,...) to the settings in EEPROM
+//
+
+static bool configurePad(const char* specification) {
+	// determine pad
+	char* p;
+	int pad = strtol(specification, &p, 10);
+
+	if (pad < 1 || pad > PAD_COUNT || *p++ != ':') {
+		fprintf(stderr, "Invalid pad specification %s\n", specification);
+		return false;
+	}
+
+	// get current settings
+	Properties properties;
+	int offset = (pad - 1) * MAX_BYTES_PER_PAD;
+	properties.loadSettings(offset);
+
+	// apply changes
+	while (*p) {
+		const char* name = p;
+		p = strchr(p, '=');
+
+		if (!p) {
+			fprintf(stderr, "Invalid pad setting %s\n", name);
+			return false;
+		}
+
+		size_t length = p++ - name;
+		int value = strtol(p, &p, 10);
+		bool found = false;
+
+		for (auto& setting : settings) {
+			if (strlen(setting.name) == length && !strncmp(setting.name, name, length)) {
+				properties.*setting.field = value;
+				found = true;
+			}
+		}
+
+		if (!found) {
+			fprintf(stderr, "Unknown pad setting %.*s\n", (int) length, name);
+			return false;
+		}
+
+		if (*p == ',') {
+			p++;
+		}
+	}
+
+	properties.saveSettings(offset);
+	return true;
+}
+
+
+//
+//	Print capture upload statistics (if there were any uploads)
+//
+
+static void printUploads() {
+	if (uploadPasses) {
+		// samples carried by data messages (raw or packed)
+		size_t samples = 0;
+
+		for (auto& msg : usbMIDI.sysex) {
+			if (msg.size() >= 10 && (msg[2] == MIDI_MONITOR_DATA || msg[2] == MIDI_MONITOR_PACKED)) {
+				samples += (msg[7] << 7) | msg[8];
+
+			} else if (msg.size() >= 9 && (msg[2] == MIDI_OSCILLOSCOPE_DATA || msg[2] == MIDI_OSCILLOSCOPE_PACKED)) {
+				samples += (msg[6] << 7) | msg[7];
+			}
+		}
+
+		fprintf(stderr, "uploads:        %lu sysex bytes in %lu passes (%d largest, %d fit a tick)\n",
+			usbMIDI.sysexBytes, uploadPasses.load(), largestPass.load(), USB_MIDI_RATE / SAMPLING_RATE);
+		if (samples) {
+			fprintf(stderr, "upload size:    %zu samples, %.2f bytes per sample\n", samples, (double) usbMIDI.sysexBytes / samples);
+		}
+	}
+}
+
+
+//
+//	Send crosstalk ratio (source:target=ratio) to the kit as a midi message
+//
+
+static bool configureCrosstalk(const char* specification) {
+	int source, target, ratio;
+
+	if (sscanf(specification, "%d:%d=%d", &source, &target, &ratio) != 3 ||
+		source < 1 || source > PAD_COUNT || target < 1 || target > PAD_COUNT || ratio < 0 || ratio > 127) {
+		fprintf(stderr, "Invalid crosstalk specification %s\n", specification);
+		return false;
+	}
+
+	uint8_t msg[] = {0xf0, MIDI_VENDOR_ID, MIDI_UPDATE_CROSSTALK, (uint8_t) source, (uint8_t) target, (uint8_t) ratio, 0xf7};
+	context.kit->midiEvent(msg, sizeof(msg));
+	return true;
+}
+
+
+//
+//	Send monitor request (pad:samples) to the monitor
+//
+
+static bool configureMonitor(const char* specification, int encoding) {
+	int pad, samples = 0;
+
+	if (sscanf(specification, "%d:%d", &pad, &samples) < 1 || pad < 1 || pad > PAD_COUNT || samples < 0 || samples > 16383) {
+		fprintf(stderr, "Invalid monitor specification %s\n", specification);
+		return false;
+	}
+
+	uint8_t msg[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, (uint8_t) pad, (uint8_t) (samples >> 7), (uint8_t) (samples & 0x7f), (uint8_t) encoding, 0xf7};
+	context.monitor->midiEvent(msg, sizeof(msg));
+	return true;
+}
+
+
+//
+//	Send oscilloscope request (up to 4 comma separated sensors, optionally
+//	followed by :setting=value,...) to the oscilloscope
+//
+
+static bool configureOscilloscope(const char* specification, int encoding) {
+	// determine probes
+	int probes[4] = {0};
+	int count = 0;
+	char* p = (char*) specification;
+
+	while (true) {
+		probes[count++] = strtol(p, &p, 10);
+
+		if (count == 4 || *p != ',') {
+			break;
+		}
+
+		p++;
+	}
+
+	if (std::any_of(probes, probes + count, [](int p) { return p < 1 || p > NUMBER_OF_SENSORS; }) || (*p && *p++ != ':')) {
+		fprintf(stderr, "Invalid oscilloscope specification %s\n", specification);
+		return false;
+	}
+
+	// apply settings (stream is the decimation, 0 for single shot captures)
+	int stream = 0, trigger = 1, edge = OSCILLOSCOPE_EITHER, level = OSCILLOSCOPE_LEVEL, pretrigger = 0;
+
+	static const struct {
+		const char* name;
+		int* value;
+		int minimum;
+		int maximum;
+	} oscilloscopeSettings[] = {
+		{"stream", &stream, 0, 127},
+		{"trigger", &trigger, 1, 4},
+		{"edge", &edge, OSCILLOSCOPE_EITHER, OSCILLOSCOPE_FALLING},
+		{"level", &level, -1024, 1023},
+		{"pretrigger", &pretrigger, 0, OSCILLOSCOPE_BUFFER_SIZE - 1}
+	};
+
+	while (*p) {
+		const char* name = p;
+		p = strchr(p, '=');
+
+		if (!p) {
+			fprintf(stderr, "Invalid oscilloscope setting %s\n", name);
+			return false;
+		}
+
+		size_t length = p++ - name;
+		int value = strtol(p, &p, 10);
+		bool found = false;
+
+		for (auto& setting : oscilloscopeSettings) {
+			if (strlen(setting.name) == length && !strncmp(setting.name, name, length)) {
+				if (value < setting.minimum || value > setting.maximum) {
+					fprintf(stderr, "Invalid oscilloscope setting %.*s=%d\n", (int) length, name, value);
+					return false;
+				}
+
+				*setting.value = value;
+				found = true;
+			}
+		}
+
+		if (!found) {
+			fprintf(stderr, "Unknown oscilloscope setting %.*s\n", (int) length, name);
+			return false;
+		}
+
+		if (*p == ',') {
+			p++;
+		}
+	}
+
+	uint8_t msg[] = {0xf0, MIDI_VENDOR_ID, MIDI_OSCILLOSCOPE_REQUEST, 1,
+		(uint8_t) probes[0], (uint8_t) probes[1], (uint8_t) probes[2], (uint8_t) probes[3], (uint8_t) encoding,
+		(uint8_t) (stream ? OSCILLOSCOPE_STREAM : OSCILLOSCOPE_SINGLE), (uint8_t) trigger, (uint8_t) edge,
+		(uint8_t) ((level + 1024) >> 7), (uint8_t) ((level + 1024) & 0x7f),
+		(uint8_t) (pretrigger >> 7), (uint8_t) (pretrigger & 0x7f), (uint8_t) stream, 0xf7};
+
+	oscilloscope.midiEvent(msg, sizeof(msg));
+	return true;
+}
+
+
+//
+//	Detection context (like the firmware's, returns number of commands applied)
+//
+
+static int detect(bool process) {
+	// apply configuration changes queued by the background
+	Command command;
+	int applied = 0;
+
+	while (commands.pop(command)) {
+		if (command.data[2] == MIDI_MONITOR_REQUEST) {
+			context.monitor->midiEvent(command.data, command.size);
+
+		} else if (command.data[2] == MIDI_OSCILLOSCOPE_REQUEST) {
+			oscilloscope.midiEvent(command.data, command.size);
+
+		} else {
+			context.kit->midiEvent(command.data, command.size);
+		}
+
+		applied++;
+	}
+
+	// process the latest frame
+	context.scanner->read();
+	context.now = context.scanner->getTime();
+	tick = context.now;
+
+	if (process) {
+		context.kit->process(&context);
+		oscilloscope.process(&context);
+	}
+
+	return applied;
+}
+
+
+//
+//	Background context (like the firmware's loop, returns number of hits sent)
+//
+
+static int background() {
+	int sent = output.drain(context.hits, tick);
+
+	// send a bounded part of completed captures
+	int budget = context.monitor->transmit(SYSEX_BUDGET);
+	budget = oscilloscope.transmit(budget);
+	int bytes = SYSEX_BUDGET - budget;
+
+	if (bytes) {
+		uploadPasses++;
+		largestPass = std::max(largestPass.load(), bytes);
+	}
+
+	return sent;
+}
+
+
+//
+//	Restart recording, time and captured output
+//
+
+static void restart(Replay& replay) {
+	replay.attach();
+	resetClock();
+	usbMIDI.events.clear();
+	usbMIDI.sysex.clear();
+	usbMIDI.sysexBytes = 0;
+	usbMIDI.flushes = 0;
+	uploadPasses = 0;
+	largestPass = 0;
+}
+
+
+//
+//	Replay the recording as fast as we can (returns elapsed time in seconds)
+//
+
+static double run(Replay& replay, bool process) {
+	restart(replay);
+	auto start = std::chrono::steady_clock::now();
+
+	while (replay.next()) {
+		// the scan timer fires and the frame is converted
+		advanceClock(1000000 / SAMPLING_RATE);
+		context.scanner->start();
+
+		// run detection on the frame and let the background send the results
+		detect(process);
+		background();
+	}
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+//
+//	Replay with detection and background on separate threads and check that
+//	every note arrives in order (unless the queue reported it as dropped)
+//
+
+static bool stress(Replay& replay, bool realTime) {
+	// notes of a regular replay are the reference
+	run(replay, true);
+	std::vector<MidiEvent> reference;
+
+	for (auto& event : usbMIDI.events) {
+		if (event.type == MIDI_NOTE_ON) {
+			reference.push_back(event);
+		}
+	}
+
+	// run detection on its own thread
+	restart(replay);
+	unsigned int noteOverruns = context.hits->getOverruns();
+	unsigned int commandOverruns = commands.getOverruns();
+	std::atomic<bool> done{false};
+	std::atomic<int> applied{0};
+
+	std::thread detection([&]() {
+		auto start = std::chrono::steady_clock::now();
+
+		for (auto frame = 1; replay.next(); frame++) {
+			advanceClock(1000000 / SAMPLING_RATE);
+			context.scanner->start();
+			applied += detect(true);
+
+			// keep up with the wall clock (every millisecond to limit the number of sleeps)
+			if (realTime && frame % (SAMPLING_RATE / 1000) == 0) {
+				std::this_thread::sleep_until(start + std::chrono::microseconds(frame * (1000000 / SAMPLING_RATE)));
+			}
+		}
+
+		done = true;
+	});
+
+	// meanwhile, the background sends notes and overfills the command queue with every batch
+	uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 0, 0, 0xf7};
+	Command command;
+	command.size = sizeof(request);
+	memcpy(command.data, request, sizeof(request));
+	int pushed = 0;
+	int batches = 0;
+	int largest = 0;
+
+	while (!done) {
+		int sent = background();
+
+		if (sent) {
+			batches++;
+			largest = std::max(largest, sent);
+
+			for (auto i = 0; i <= COMMAND_QUEUE_SIZE; i++) {
+				commands.push(command);
+				pushed++;
+			}
+
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	// pick up what was left in the queues
+	detection.join();
+	applied += detect(false);
+	background();
+
+	// compare received notes with the reference
+	std::vector<MidiEvent> received;
+
+	for (auto& event : usbMIDI.events) {
+		if (event.type == MIDI_NOTE_ON) {
+			received.push_back(event);
+		}
+	}
+
+	noteOverruns = context.hits->getOverruns() - noteOverruns;
+	commandOverruns = commands.getOverruns() - commandOverruns;
+	size_t r = 0;
+
+	for (auto& event : reference) {
+		if (r < received.size() && received[r].data1 == event.data1 && received[r].data2 == event.data2) {
+			r++;
+		}
+	}
+
+	bool ok = r == received.size() && received.size() + noteOverruns == reference.size() &&
+		applied + commandOverruns == (unsigned int) pushed;
+
+	fprintf(stderr, "stress:         %zu of %zu notes received in order, %u dropped (queue full)\n", received.size(), reference.size(), noteOverruns);
+	fprintf(stderr, "commands:       %d applied, %u dropped (queue full)\n", applied.load(), commandOverruns);
+
+	if (batches) {
+		fprintf(stderr, "output:         %d batches (%.1f hits average, %d largest), worst latency %lu ticks\n",
+			batches, (double) received.size() / batches, largest, output.getLatency());
+	}
+
+	printUploads();
+
+	fprintf(stderr, "result:         %s\n", ok ? "ok" : "MISMATCH");
+	return ok;
+}
+
+
+//
+//	Score notes against the hits that were actually played
+//
+
+static bool scoreTruth(const char* filename) {
+	// load ground truth
+	FILE* file = fopen(filename, "r");
+
+	if (!file) {
+		fprintf(stderr, "Can't open ground truth %s\n", filename);
+		return false;
+	}
+
+	struct Hit {
+		double time;
+		int note;
+		int position;
+	};
+
+	std::vector<Hit> hits;
+	char line[256];
+
+	while (fgets(line, sizeof(line), file)) {
+		Hit hit = {0.0, 0, -1};
+
+		if (sscanf(line, "%lf,%d,%d", &hit.time, &hit.note, &hit.position) >= 2) {
+			hits.push_back(hit);
+		}
+	}
+
+	fclose(file);
+
+	// match every hit with the first unused note on the same key in the 10 ms that follow
+	std::vector<bool> used(usbMIDI.events.size());
+	size_t detected = 0;
+	size_t positions = 0;
+	double error = 0.0;
+	int worst = 0;
+
+	for (auto& hit : hits) {
+		for (size_t i = 0; i < usbMIDI.events.size(); i++) {
+			auto& event = usbMIDI.events[i];
+			double difference = event.time / 1000.0 - hit.time;
+
+			if (!used[i] && event.type == MIDI_NOTE_ON && event.data1 == hit.note && difference >= 0.0 && difference < 10.0) {
+				used[i] = true;
+				detected++;
+
+				// a position is sent as a control change right before the note
+				if (hit.position >= 0 && i && usbMIDI.events[i - 1].type == MIDI_CONTROL_CHANGE && usbMIDI.events[i - 1].time == event.time) {
+					int deviation = abs(usbMIDI.events[i - 1].data2 - hit.position);
+					error += deviation;
+					worst = std::max(worst, deviation);
+					positions++;
+				}
+
+				break;
+			}
+		}
+	}
+
+	// notes that don't belong to a hit are retriggers
+	size_t extra = 0;
+
+	for (size_t i = 0; i < usbMIDI.events.size(); i++) {
+		if (!used[i] && usbMIDI.events[i].type == MIDI_NOTE_ON) {
+			extra++;
+		}
+	}
+
+	size_t missed = hits.size() - detected;
+	double total = std::max(hits.size(), (size_t) 1);
+
+	fprintf(stderr, "truth:          %zu of %zu hits detected, %zu missed (%.1f%%), %zu extra (%.1f%%)\n",
+		detected, hits.size(), missed, missed * 100.0 / total, extra, extra * 100.0 / total);
+
+	if (positions) {
+		fprintf(stderr, "position:       %zu hits, %.1f average error, %d worst (in 0-127 units)\n", positions, error / positions, worst);
+	}
+
+	return true;
+}
+
+
+//
+//	Compare notes with a replay that has prediction disabled on all pads
+//
+
+static void benchmarkPrediction(Replay& replay) {
+	// keep notes as configured
+	std::vector<MidiEvent> predicted;
+
+	for (auto& event : usbMIDI.events) {
+		if (event.type == MIDI_NOTE_ON) {
+			predicted.push_back(event);
+		}
+	}
+
+	// disable prediction and replay again
+	context.kit->saveSettings();
+
+	for (auto i = 0; i < PAD_COUNT; i++) {
+		Properties properties;
+		properties.loadSettings(i * MAX_BYTES_PER_PAD);
+		properties.predictTime = 0;
+		properties.saveSettings(i * MAX_BYTES_PER_PAD);
+	}
+
+	context.kit->loadSettings();
+	run(replay, true);
+
+	// match every note with the first later note on the same key
+	std::vector<bool> used(usbMIDI.events.size());
+	size_t matched = 0;
+	double saved = 0.0;
+	double error = 0.0;
+	int worst = 0;
+
+	for (auto& note : predicted) {
+		for (size_t i = 0; i < usbMIDI.events.size(); i++) {
+			auto& event = usbMIDI.events[i];
+
+			if (!used[i] && event.type == MIDI_NOTE_ON && event.data1 == note.data1 &&
+				event.time >= note.time && event.time - note.time < 10000) {
+				int difference = abs(note.data2 - event.data2);
+				used[i] = true;
+				matched++;
+				saved += event.time - note.time;
+				error += difference;
+				worst = std::max(worst, difference);
+				break;
+			}
+		}
+	}
+
+	size_t notes = std::count(used.begin(), used.end(), false);
+
+	for (auto& event : usbMIDI.events) {
+		if (event.type != MIDI_NOTE_ON) {
+			notes--;
+		}
+	}
+
+	fprintf(stderr, "prediction:     %zu of %zu notes matched (%zu unmatched full window notes)\n", matched, predicted.size(), notes);
+
+	if (matched) {
+		fprintf(stderr, "latency saved:  %.3f ms average\n", saved / matched / 1000.0);
+		fprintf(stderr, "velocity error: %.2f average, %d worst\n", error / matched, worst);
+	}
+}
+
+
+//
+//	Main function
+//
+
+int main(int argc, char* argv[]) {
+	// process options
+	const char* format = nullptr;
+	int channels = NUMBER_OF_SENSORS;
+	std::vector<const char*> pads;
+	std::vector<const char*> crosstalk;
+	const char* truth = nullptr;
+	const char* monitor = nullptr;
+	const char* probes = nullptr;
+	int repeats = 1;
+	int encoding = ENCODING_RAW;
+	bool events = false;
+	bool benchmark = false;
+	bool threads = false;
+	bool realTime = false;
+	int option;
+
+	while ((option = getopt(argc, argv, "f:c:p:x:r:g:m:o:btwzeh")) != -1) {
+		switch (option) {
+			case 'f': format = optarg; break;
+			case 'c': channels = atoi(optarg); break;
+			case 'p': pads.push_back(optarg); break;
+			case 'x': crosstalk.push_back(optarg); break;
+			case 'r': repeats = atoi(optarg); break;
+			case 'g': truth = optarg; break;
+			case 'm': monitor = optarg; break;
+			case 'o': probes = optarg; break;
+			case 'b': benchmark = true; break;
+			case 't': threads = true; break;
+			case 'w': realTime = true; break;
+			case 'z': encoding = ENCODING_PACKED; break;
+			case 'e': events = true; break;
+			default: usage(); return 1;
+		}
+	}
+
+	if (optind != argc - 1 || channels < 1 || repeats < 1) {
+		usage();
+		return 1;
+	}
+
+	// determine format from extension (if required)
+	const char* filename = argv[optind];
+
+	if (!format) {
+		const char* extension = strrchr(filename, '.');
+		format = extension ? extension + 1 : "raw";
+	}
+
+	// load recording
+	Replay replay;
+
+	if (!replay.load(filename, format, channels)) {
+		return 1;
+	}
+
+	replay.attach();
+
+	// create scanner, drumkit and monitor (just like the firmware does)
+	context.scanner = new Scanner();
+	context.kit = new Kit();
+	context.monitor = new Monitor(&arena);
+	context.hits = new HitQueue();
+
+	// apply pad settings by going through EEPROM (just like a stored kit)
+	if (pads.size()) {
+		context.kit->saveSettings();
+
+		for (auto pad : pads) {
+			if (!configurePad(pad)) {
+				return 1;
+			}
+		}
+
+		context.kit->loadSettings();
+	}
+
+	for (auto pair : crosstalk) {
+		if (!configureCrosstalk(pair)) {
+			return 1;
+		}
+	}
+
+	if (monitor && !configureMonitor(monitor, encoding)) {
+		return 1;
+	}
+
+	if (probes && !configureOscilloscope(probes, encoding)) {
+		return 1;
+	}
+
+	// time scanning on its own and with the kit, Kit::process gets the difference
+	double scanTime = 1e9;
+	double elapsed = 1e9;
+
+	for (auto i = 0; i < repeats; i++) {
+		scanTime = std::min(scanTime, run(replay, false));
+		elapsed = std::min(elapsed, run(replay, true));
+	}
+
+	double kitElapsed = elapsed - scanTime;
+
+	// report results
+	if (events) {
+		printEvents();
+
+		if (!printCaptures()) {
+			return 1;
+		}
+	}
+
+	size_t frames = replay.getFrames();
+	double duration = (double) frames / SAMPLING_RATE;
+	size_t notes = 0;
+
+	for (auto& event : usbMIDI.events) {
+		if (event.type == MIDI_NOTE_ON) {
+			notes++;
+		}
+	}
+
+	fprintf(stderr, "frames:         %zu (%.3f s at %d Hz)\n", frames, duration, SAMPLING_RATE);
+	fprintf(stderr, "notes:          %zu (%zu midi events, %lu sysex bytes)\n", notes, usbMIDI.events.size(), usbMIDI.sysexBytes);
+	fprintf(stderr, "overruns:       %u\n", context.scanner->getOverruns());
+
+	printUploads();
+
+	// gate of each note (time to the first note off on the same key that follows)
+	std::vector<bool> closed(usbMIDI.events.size());
+	unsigned long shortest = ~0ul;
+	unsigned long longest = 0;
+	double total = 0.0;
+
+	for (size_t i = 0; i < usbMIDI.events.size(); i++) {
+		if (usbMIDI.events[i].type == MIDI_NOTE_ON) {
+			for (size_t j = i; j < usbMIDI.events.size(); j++) {
+				auto& event = usbMIDI.events[j];
+
+				if (!closed[j] && event.type == MIDI_NOTE_OFF && event.data1 == usbMIDI.events[i].data1) {
+					unsigned long gate = event.time - usbMIDI.events[i].time;
+					shortest = std::min(shortest, gate);
+					longest = std::max(longest, gate);
+					total += gate;
+					closed[j] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (notes) {
+		fprintf(stderr, "gates:          %.3f ms shortest, %.3f ms average, %.3f ms longest\n",
+			shortest / 1000.0, total / notes / 1000.0, longest / 1000.0);
+	}
+
+	// short recordings replay in less time than the clock and scheduler noise
+	if (elapsed >= MINIMUM_TIMING && kitElapsed > 0.0) {
+		fprintf(stderr, "replay:         %.3f s (%.0f frames/s, %.1fx real time)\n", elapsed, frames / elapsed, duration / elapsed);
+		fprintf(stderr, "Kit::process:   %.3f s (%.0f frames/s, %.1f ns/frame)\n", kitElapsed, frames / kitElapsed, kitElapsed * 1e9 / frames);
+
+	} else {
+		fprintf(stderr, "replay:         %.6f s (n/a, recording too short to time)\n", elapsed);
+		fprintf(stderr, "Kit::process:   n/a\n");
+	}
+
+	if (truth && !scoreTruth(truth)) {
+		return 1;
+	}
+
+	if (benchmark) {
+		benchmarkPrediction(replay);
+	}
+
+	if (threads && !stress(replay, realTime)) {
+		return 1;
+	}
+
+	return 0;
+}
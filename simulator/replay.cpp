@@ -0,0 +1,250 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+#include "scanner.h"
+
+
+//
+//	Replay that feeds the virtual ADC
+//
+
+static Replay* source = nullptr;
+
+
+//
+//	Replay::load
+//
+
+bool Replay::load(const char* filename, const char* format, int channels) {
+	FILE* file = fopen(filename, "rb");
+
+	if (!file) {
+		fprintf(stderr, "Can't open %s\n", filename);
+		return false;
+	}
+
+	bool result;
+
+	if (!strcmp(format, "csv")) {
+		result = loadCsv(file);
+
+	} else if (!strcmp(format, "raw")) {
+		result = loadRaw(file, channels);
+
+	} else if (!strcmp(format, "wav")) {
+		result = loadWav(file);
+
+	} else {
+		fprintf(stderr, "Unknown format %s\n", format);
+		result = false;
+	}
+
+	fclose(file);
+	return result;
+}
+
+
+//
+//	Replay::attach
+//
+
+void Replay::attach() {
+	source = this;
+	position = -1;
+}
+
+
+//
+//	Replay::addFrame
+//
+
+void Replay::addFrame(const int* values, int channels) {
+	for (auto i = 0; i < NUMBER_OF_SENSORS; i++) {
+		samples.push_back(i < channels ? values[i] : 0);
+	}
+
+	frames++;
+}
+
+
+//
+//	Replay::next
+//
+
+bool Replay::next() {
+	return ++position < (long) frames;
+}
+
+
+//
+//	Replay::loadCsv
+//
+
+bool Replay::loadCsv(FILE* file) {
+	char line[4096];
+
+	while (fgets(line, sizeof(line), file)) {
+		// skip comments and empty lines
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+			continue;
+		}
+
+		// parse values (missing channels are silent)
+		char* p = line;
+
+		for (auto i = 0; i < NUMBER_OF_SENSORS; i++) {
+			char* end;
+			long value = strtol(p, &end, 10);
+
+			if (end == p) {
+				samples.push_back(0);
+
+			} else {
+				samples.push_back((int16_t) value);
+				p = end;
+
+				while (*p == ',' || *p == ' ' || *p == '\t') {
+					p++;
+				}
+			}
+		}
+
+		frames++;
+	}
+
+	return true;
+}
+
+
+//
+//	Replay::loadRaw
+//
+
+bool Replay::loadRaw(FILE* file, int channels) {
+	std::vector<int16_t> pcm(channels);
+
+	while (fread(pcm.data(), sizeof(int16_t), channels, file) == (size_t) channels) {
+		addPcm(pcm.data(), channels);
+	}
+
+	return true;
+}
+
+
+//
+//	Replay::loadWav
+//
+
+bool Replay::loadWav(FILE* file) {
+	// check header
+	char riff[12];
+
+	if (fread(riff, 1, sizeof(riff), file) != sizeof(riff) || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+		fprintf(stderr, "Not a WAV file\n");
+		return false;
+	}
+
+	// walk chunks
+	int channels = 0;
+	char id[4];
+	uint32_t size;
+
+	while (fread(id, 1, 4, file) == 4 && fread(&size, 4, 1, file) == 1) {
+		if (!memcmp(id, "fmt ", 4)) {
+			// check sample format
+			struct {
+				uint16_t format;
+				uint16_t channels;
+				uint32_t rate;
+				uint32_t byteRate;
+				uint16_t blockAlign;
+				uint16_t bits;
+			} fmt;
+
+			if (size < sizeof(fmt) || fread(&fmt, sizeof(fmt), 1, file) != 1) {
+				return false;
+			}
+
+			if (fmt.format != 1 || fmt.bits != 16) {
+				fprintf(stderr, "Only 16 bit PCM WAV files are supported\n");
+				return false;
+			}
+
+			if (fmt.rate != SAMPLING_RATE) {
+				fprintf(stderr, "Warning: WAV file is %u Hz, replaying at %d Hz\n", fmt.rate, SAMPLING_RATE);
+			}
+
+			channels = fmt.channels;
+			fseek(file, size - sizeof(fmt) + (size & 1), SEEK_CUR);
+
+		} else if (!memcmp(id, "data", 4)) {
+			if (!channels) {
+				fprintf(stderr, "WAV file has no format chunk\n");
+				return false;
+			}
+
+			// read frames
+			std::vector<int16_t> pcm(channels);
+			size_t count = size / (channels * sizeof(int16_t));
+
+			for (size_t i = 0; i < count && fread(pcm.data(), sizeof(int16_t), channels, file) == (size_t) channels; i++) {
+				addPcm(pcm.data(), channels);
+			}
+
+			return true;
+
+		} else {
+			// skip other chunks
+			fseek(file, size + (size & 1), SEEK_CUR);
+		}
+	}
+
+	fprintf(stderr, "WAV file has no data chunk\n");
+	return false;
+}
+
+
+//
+//	Replay::addPcm
+//
+
+void Replay::addPcm(const int16_t* pcm, int channels) {
+	// scale full range samples down to 10 bits
+	for (auto i = 0; i < NUMBER_OF_SENSORS; i++) {
+		samples.push_back(i < channels ? pcm[i] >> 6 : 0);
+	}
+
+	frames++;
+}
+
+
+//
+//	Virtual ADC (host implementation of the scanner's hardware layer)
+//
+
+void Scanner::begin() {
+}
+
+void Scanner::convert(const ScanStep& step) {
+	// conversions complete immediately
+	int sensor = step.pair * 16 + step.address + 1;
+
+	if (source) {
+		complete(source->getValue(sensor), source->getValue(sensor + 8));
+
+	} else {
+		complete(512, 512);
+	}
+}
@@ -0,0 +1,75 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "config.h"
+
+
+//
+//	Replay class that feeds recorded samples to the scanner
+//
+//	Recordings hold one channel per sensor (channel 1 is sensor 1). CSV files
+//	have one frame per line with signed values in ADC units (-512 to 511).
+//	Raw (interleaved 16 bit little endian) and WAV (16 bit PCM) files are full
+//	scale and get scaled down to the 10 bit ADC range. The virtual ADC adds a
+//	mid-scale DC offset, just like the sensor boards do.
+//
+
+class Replay {
+public:
+	// load recording (format is "csv", "raw" or "wav")
+	bool load(const char* filename, const char* format, int channels);
+
+	// make this the source for the scanner's virtual ADC
+	void attach();
+
+	// add a frame of signed values in ADC units (for generated recordings)
+	void addFrame(const int* values, int channels);
+
+	// advance to next frame (returns false at end of recording)
+	bool next();
+
+	// get number of frames in recording
+	inline size_t getFrames() {
+		return frames;
+	}
+
+	// get raw ADC value for a sensor in the current frame
+	inline int getValue(int sensor) {
+		if (position < 0 || position >= (long) frames) {
+			return 512;
+		}
+
+		int value = samples[position * NUMBER_OF_SENSORS + sensor - 1] + 512;
+		return value < 0 ? 0 : (value > 1023 ? 1023 : value);
+	}
+
+private:
+	// format specific loaders
+	bool loadCsv(FILE* file);
+	bool loadRaw(FILE* file, int channels);
+	bool loadWav(FILE* file);
+
+	// add a frame of pcm samples
+	void addPcm(const int16_t* pcm, int channels);
+
+	// samples (NUMBER_OF_SENSORS per frame)
+	std::vector<int16_t> samples;
+	size_t frames = 0;
+	long position = -1;
+};
@@ -0,0 +1,52 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "usb_midi.h"
+
+
+//
+//	Host replacements for the Teensy core functions used by the firmware
+//
+
+using std::min;
+using std::max;
+
+#define LOW 0
+#define HIGH 1
+
+// simulated time (advanced by the simulator once per frame)
+unsigned long micros();
+
+inline void delayMicroseconds(unsigned int) {
+}
+
+
+//
+//	Serial port (sent to stderr so it doesn't mix with captured output)
+//
+
+class usb_serial_class {
+public:
+	inline void println(const char* text) { fprintf(stderr, "%s\n", text); }
+	inline void println(int value) { fprintf(stderr, "%d\n", value); }
+};
+
+extern usb_serial_class Serial;
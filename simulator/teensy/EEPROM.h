@@ -0,0 +1,31 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+
+//
+//	EEPROM emulated in memory
+//
+
+class EEPROMClass {
+public:
+	inline uint8_t read(int offset) { return memory[offset]; }
+	inline void update(int offset, uint8_t value) { memory[offset] = value; }
+
+private:
+	uint8_t memory[4096] = {0};
+};
+
+extern EEPROMClass EEPROM;
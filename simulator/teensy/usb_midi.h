@@ -0,0 +1,78 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdint.h>
+
+#include <vector>
+
+
+//
+//	Captured midi event
+//
+
+struct MidiEvent {
+	unsigned long time;
+	uint8_t type;
+	uint8_t channel;
+	uint8_t data1;
+	uint8_t data2;
+};
+
+
+//
+//	Midi event types (status byte without channel)
+//
+
+enum {
+	MIDI_NOTE_OFF = 0x80,
+	MIDI_NOTE_ON = 0x90,
+	MIDI_AFTERTOUCH_POLY = 0xa0,
+	MIDI_CONTROL_CHANGE = 0xb0,
+	MIDI_SYSEX = 0xf0
+};
+
+
+//
+//	Midi sink that captures everything the firmware sends
+//
+
+class usb_midi_class {
+public:
+	// channel messages
+	void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel);
+	void sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel);
+	void sendAfterTouchPoly(uint8_t note, uint8_t pressure, uint8_t channel);
+	void sendControlChange(uint8_t control, uint8_t value, uint8_t channel);
+
+	// system exclusive messages
+	void sendSysEx(uint32_t length, const uint8_t* data, bool hasTerm=false);
+
+	// there is no host side input (flushes are only counted)
+	inline bool read() { return false; }
+	inline void send_now() { flushes++; }
+	inline void setHandleSystemExclusive(void (*)(uint8_t* data, unsigned int size)) {}
+
+	// captured events
+	std::vector<MidiEvent> events;
+	std::vector<std::vector<uint8_t>> sysex;
+	unsigned long sysexBytes = 0;
+	unsigned long flushes = 0;
+
+	// sysex bytes per second the link takes (0 sends without taking time)
+	unsigned long linkRate = 0;
+	unsigned long long linkBytes = 0;
+	unsigned long long linkTime = 0;
+};
+
+extern usb_midi_class usbMIDI;
@@ -0,0 +1,49 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include "arena.h"
+#include "monitor.h"
+#include "oscilloscope.h"
+#include "test.h"
+
+
+//
+//	Monitor and oscilloscope share the arena when their parts fit together,
+//	otherwise the second one is turned down until the first is released
+//
+
+TEST(arenaShare) {
+	Arena arena;
+
+	// a full oscilloscope capture leaves no room for a monitor session
+	int16_t* probes = arena.allocate(ARENA_OSCILLOSCOPE, 4 * OSCILLOSCOPE_BUFFER_SIZE);
+	CHECK(probes != nullptr);
+	CHECK(arena.allocate(ARENA_MONITOR, 3 * MONITOR_BUFFER_SIZE) == nullptr);
+
+	arena.release(ARENA_OSCILLOSCOPE);
+	int16_t* channels = arena.allocate(ARENA_MONITOR, 3 * MONITOR_BUFFER_SIZE);
+	CHECK(channels != nullptr);
+
+	// one probe fits next to a monitor session, two don't
+	CHECK(arena.allocate(ARENA_OSCILLOSCOPE, 2 * OSCILLOSCOPE_BUFFER_SIZE) == nullptr);
+	probes = arena.allocate(ARENA_OSCILLOSCOPE, OSCILLOSCOPE_BUFFER_SIZE);
+
+	if (CHECK(probes != nullptr)) {
+		CHECK(probes >= channels + 3 * MONITOR_BUFFER_SIZE);
+	}
+
+	// once both are released, either one gets the whole arena
+	arena.release(ARENA_MONITOR);
+	arena.release(ARENA_OSCILLOSCOPE);
+	CHECK(arena.allocate(ARENA_MONITOR, DIAGNOSTICS_ARENA_SIZE) != nullptr);
+	arena.release(ARENA_MONITOR);
+	CHECK(arena.allocate(ARENA_OSCILLOSCOPE, DIAGNOSTICS_ARENA_SIZE) != nullptr);
+}
@@ -0,0 +1,125 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "player.h"
+#include "test.h"
+#include "type.h"
+
+
+//
+//	Cymbal on pad 1 with its bow piezo on sensor 1 and edge on sensor 2
+//
+
+static const int MS = SAMPLING_RATE / 1000;
+static const int HEAD_NOTE = 51;
+static const int EDGE_NOTE = 53;
+
+static std::vector<int> bow;
+static std::vector<int> edge;
+
+static void strike(std::vector<int>& channel, int ms, int amplitude) {
+	for (auto i = 0; i < 500 * MS; i++) {
+		double t = (double) i / SAMPLING_RATE;
+		channel[ms * MS + i] += (int) (amplitude * exp(-t / 0.015) * sin(2 * M_PI * 300 * t));
+	}
+}
+
+static void hold(int ms, int duration) {
+	for (auto i = 0; i < duration * MS; i++) {
+		edge[ms * MS + i] += 120;
+	}
+}
+
+static std::vector<MidiEvent> playCymbal() {
+	resetPads();
+	Properties properties = getPad(1);
+	properties.type = TYPE_CY15R;
+	properties.zones = DUAL_ZONE;
+	properties.headNote = HEAD_NOTE;
+	properties.rimSensor = 2;
+	properties.rimNote = EDGE_NOTE;
+	setPad(1, properties);
+
+	// pad 2 would use the edge sensor as its head
+	properties = getPad(2);
+	properties.headSensor = 0;
+	setPad(2, properties);
+
+	Replay replay;
+
+	for (size_t i = 0; i < bow.size(); i++) {
+		int values[2] = {bow[i], edge[i]};
+		replay.addFrame(values, 2);
+	}
+
+	return play(replay);
+}
+
+static int count(const std::vector<MidiEvent>& events, int type, int note, int value, int from, int to) {
+	int found = 0;
+
+	for (auto& event : events) {
+		if (event.type == type && event.data1 == note && (value < 0 || event.data2 == value) &&
+			event.time >= (unsigned long) from * MS && event.time < (unsigned long) to * MS) {
+			found++;
+		}
+	}
+
+	return found;
+}
+
+
+//
+//	Holding the edge of a ringing cymbal chokes it, hitting the edge plays it
+//
+
+TEST(choke) {
+	bow.assign(6000 * MS, 0);
+	edge.assign(6000 * MS, 0);
+
+	strike(bow, 100, 400);
+	hold(600, 400);
+
+	// a hit on the edge only (nothing reaches the bow piezo) while the cymbal rings
+	strike(bow, 1500, 400);
+	strike(edge, 1900, 300);
+
+	// a brief touch while it rings
+	strike(bow, 3000, 400);
+	hold(3400, 8);
+
+	// grabbing the edge right after a hit (during retrigger)
+	strike(bow, 4500, 400);
+	hold(4505, 300);
+
+	std::vector<MidiEvent> events = playCymbal();
+
+	// hits on the bow
+	CHECK(count(events, MIDI_NOTE_ON, HEAD_NOTE, -1, 0, 6000) == 4);
+
+	// the hold chokes after CHOKE_TIME and releases when let go
+	CHECK(count(events, MIDI_AFTERTOUCH_POLY, HEAD_NOTE, 127, 600 + CHOKE_TIME - 1, 600 + CHOKE_TIME + 1) == 1);
+	CHECK(count(events, MIDI_AFTERTOUCH_POLY, HEAD_NOTE, 0, 1000, 1002) == 1);
+
+	// the edge hit plays and doesn't choke
+	CHECK(count(events, MIDI_NOTE_ON, EDGE_NOTE, -1, 1900, 1905) == 1);
+	CHECK(count(events, MIDI_AFTERTOUCH_POLY, HEAD_NOTE, 127, 1500, 3000) == 0);
+
+	// a brief touch does nothing
+	CHECK(count(events, MIDI_AFTERTOUCH_POLY, HEAD_NOTE, 127, 3000, 4500) == 0);
+
+	// a hold during retrigger doesn't retrigger edge notes and chokes once retrigger is over
+	CHECK(count(events, MIDI_NOTE_ON, EDGE_NOTE, -1, 1905, 6000) == 0);
+	CHECK(count(events, MIDI_AFTERTOUCH_POLY, HEAD_NOTE, 127, 4500, 4805) == 1);
+	CHECK(count(events, MIDI_AFTERTOUCH_POLY, HEAD_NOTE, 0, 4805, 4807) == 1);
+}
@@ -0,0 +1,126 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "kit.h"
+
+#include "player.h"
+#include "test.h"
+
+
+//
+//	Kick on pad 1 (sensor 1) that bleeds 15% into a tom on pad 2 (sensor 2),
+//	every third kick the tom is hit at the same time for real
+//
+
+static const int MS = SAMPLING_RATE / 1000;
+static const int KICK_NOTE = 36;
+static const int TOM_NOTE = 45;
+
+static uint32_t seed;
+
+static int random(int low, int high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (int) ((seed >> 8) % (uint32_t) (high - low + 1));
+}
+
+static void strike(std::vector<double>& channel, int start, double amplitude, double frequency) {
+	for (auto i = 0; i < 30 * MS && start + i < (int) channel.size(); i++) {
+		double t = (double) i / SAMPLING_RATE;
+		channel[start + i] += amplitude * exp(-t / 0.006) * sin(2 * M_PI * frequency * t);
+	}
+}
+
+static std::vector<MidiEvent> playBleed(int ratio, std::vector<int>& toms, int& kicks) {
+	std::vector<double> kick(10000 * MS, 0.0);
+	std::vector<double> tom(kick.size(), 0.0);
+	seed = 5;
+	kicks = 0;
+	toms.clear();
+
+	for (auto t = 100 * MS; t < (int) kick.size() - 100 * MS; t += random(250 * MS, 500 * MS)) {
+		int amplitude = random(200, 480);
+		strike(kick, t, amplitude, 180);
+		strike(tom, t + 6, amplitude * 0.15, 150);
+
+		if (++kicks % 3 == 0) {
+			strike(tom, t + 10, random(200, 400), 180);
+			toms.push_back(t + 10);
+		}
+	}
+
+	resetPads();
+	Properties properties = getPad(1);
+	properties.headNote = KICK_NOTE;
+	setPad(1, properties);
+
+	properties = getPad(2);
+	properties.headNote = TOM_NOTE;
+	setPad(2, properties);
+
+	// the ratio is set like the control app does
+	Kit kit;
+	kit.loadSettings();
+	uint8_t update[] = {0xf0, MIDI_VENDOR_ID, MIDI_UPDATE_CROSSTALK, 1, 2, (uint8_t) ratio, 0xf7};
+	kit.midiEvent(update, sizeof(update));
+	kit.saveSettings();
+
+	Replay replay;
+
+	for (size_t i = 0; i < kick.size(); i++) {
+		int values[2] = {(int) kick[i] + random(-2, 2), (int) tom[i] + random(-2, 2)};
+		replay.addFrame(values, 2);
+	}
+
+	return play(replay);
+}
+
+static std::vector<MidiEvent> select(const std::vector<MidiEvent>& events, int note) {
+	std::vector<MidiEvent> selected;
+
+	for (auto& event : events) {
+		if (event.type == MIDI_NOTE_ON && event.data1 == note) {
+			selected.push_back(event);
+		}
+	}
+
+	return selected;
+}
+
+
+//
+//	Bleed from the kick plays the tom unless the ratio is set, real tom hits
+//	at the same time as a kick still play
+//
+
+TEST(crosstalk) {
+	std::vector<int> toms;
+	int kicks;
+
+	std::vector<MidiEvent> events = playBleed(0, toms, kicks);
+	CHECK(select(events, KICK_NOTE).size() == (size_t) kicks);
+	// without a ratio most of the bleed plays
+	CHECK(select(events, TOM_NOTE).size() >= toms.size() + 10);
+
+	events = playBleed(32, toms, kicks);
+	std::vector<MidiEvent> tomNotes = select(events, TOM_NOTE);
+	CHECK(kicks > 20);
+	CHECK(select(events, KICK_NOTE).size() == (size_t) kicks);
+
+	if (CHECK(tomNotes.size() == toms.size())) {
+		for (size_t i = 0; i < toms.size(); i++) {
+			CHECK(tomNotes[i].time >= (unsigned long) toms[i] && tomNotes[i].time < (unsigned long) toms[i] + 5 * MS);
+		}
+	}
+
+	resetPads();
+}
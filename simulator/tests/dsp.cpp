@@ -0,0 +1,130 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <random>
+
+#include "dsp.h"
+#include "test.h"
+
+
+//
+//	Test vectors (random values mixed with the ones at and next to the limits)
+//
+
+static const int COUNT = 32;
+static const int ROUNDS = 100000;
+
+static const int16_t limits[] = {0, 1, -1, 0x7fff, 0x7ffe, -0x8000, -0x7fff};
+
+static void fill(std::mt19937& random, int16_t* values) {
+	for (auto i = 0; i < COUNT; i++) {
+		int pick = random() % 4;
+		values[i] = pick ? (int16_t) random() : limits[random() % (sizeof(limits) / sizeof(limits[0]))];
+	}
+}
+
+static bool same(const int16_t* a, const int16_t* b) {
+	for (auto i = 0; i < COUNT; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//
+//	The kernels used by this build match the plain C ones bit for bit
+//
+
+TEST(dspRectify) {
+	std::mt19937 random(1);
+	alignas(16) int16_t in[COUNT], out[COUNT], reference[COUNT];
+
+	for (auto round = 0; round < ROUNDS; round++) {
+		fill(random, in);
+		rectify(in, out, COUNT);
+		rectifyScalar(in, reference, COUNT);
+		CHECK(same(out, reference));
+	}
+
+	// every limit in every lane
+	for (auto limit : limits) {
+		for (auto i = 0; i < COUNT; i++) {
+			in[i] = limit;
+		}
+
+		rectify(in, out, COUNT);
+		rectifyScalar(in, reference, COUNT);
+		CHECK(same(out, reference));
+	}
+
+	in[0] = -0x8000;
+	rectify(in, out, 8);
+	CHECK(out[0] == 0x7fff);
+}
+
+TEST(dspThreshold) {
+	std::mt19937 random(2);
+	alignas(16) int16_t values[COUNT], thresholds[COUNT];
+
+	for (auto round = 0; round < ROUNDS; round++) {
+		fill(random, values);
+		fill(random, thresholds);
+		CHECK(threshold(values, thresholds, COUNT) == thresholdScalar(values, thresholds, COUNT));
+
+		// shorter frames leave the upper bits clear
+		CHECK(threshold(values, thresholds, 8) == thresholdScalar(values, thresholds, 8));
+	}
+
+	// every pair of limits as value and threshold
+	for (auto value : limits) {
+		for (auto level : limits) {
+			for (auto i = 0; i < COUNT; i++) {
+				values[i] = value;
+				thresholds[i] = level;
+			}
+
+			uint32_t result = threshold(values, thresholds, COUNT);
+			CHECK(result == thresholdScalar(values, thresholds, COUNT));
+			CHECK(result == (value > level ? 0xffffffff : 0));
+		}
+	}
+}
+
+TEST(dspPeakHold) {
+	std::mt19937 random(3);
+	alignas(16) int16_t values[COUNT], peaks[COUNT], reference[COUNT];
+
+	for (auto round = 0; round < ROUNDS; round++) {
+		fill(random, values);
+		fill(random, peaks);
+		memcpy(reference, peaks, sizeof(peaks));
+		peakHold(peaks, values, COUNT);
+		peakHoldScalar(reference, values, COUNT);
+		CHECK(same(peaks, reference));
+	}
+
+	// every pair of limits as value and peak
+	for (auto value : limits) {
+		for (auto peak : limits) {
+			for (auto i = 0; i < COUNT; i++) {
+				values[i] = value;
+				peaks[i] = reference[i] = peak;
+			}
+
+			peakHold(peaks, values, COUNT);
+			peakHoldScalar(reference, values, COUNT);
+			CHECK(same(peaks, reference));
+		}
+	}
+}
@@ -0,0 +1,173 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "player.h"
+#include "test.h"
+#include "type.h"
+
+
+//
+//	Hi-hat on pad 1 with its bow piezo on sensor 1 and pedal on sensor 2
+//
+
+static const int MS = SAMPLING_RATE / 1000;
+static const int BOW_NOTE = 46;
+static const int CLOSED_NOTE = 42;
+
+// pedal readings (raw ADC) of the open and closed pedal
+static const int OPEN = 80;
+static const int CLOSED = 800;
+
+static std::vector<int> bow;
+static std::vector<double> pedal;
+
+static void strike(int ms, int amplitude) {
+	for (auto i = 0; i < 30 * MS; i++) {
+		double t = (double) i / SAMPLING_RATE;
+		bow[ms * MS + i] += (int) (amplitude * exp(-t / 0.006) * sin(2 * M_PI * 180 * t));
+	}
+}
+
+// move the pedal (0 is open, 1 closed) and hold it there
+static void move(int ms, int duration, double to) {
+	double from = pedal[ms * MS];
+
+	for (size_t i = ms * MS; i < pedal.size(); i++) {
+		double t = duration ? (double) (i - ms * MS) / (duration * MS) : 1.0;
+		pedal[i] = t < 1.0 ? from + (to - from) * t : to;
+	}
+}
+
+static std::vector<MidiEvent> playHihat() {
+	resetPads();
+	Properties properties = getPad(1);
+	properties.type = TYPE_VH12;
+	properties.zones = HIHAT;
+	properties.headNote = BOW_NOTE;
+	properties.rimSensor = 2;
+	properties.rimNote = CLOSED_NOTE;
+	properties.rimThreshold = OPEN / 8;
+	properties.rimSensitivity = CLOSED / 8;
+	setPad(1, properties);
+
+	// pad 2 would use the pedal sensor as its head
+	properties = getPad(2);
+	properties.headSensor = 0;
+	setPad(2, properties);
+
+	Replay replay;
+
+	for (size_t i = 0; i < bow.size(); i++) {
+		int values[2] = {bow[i], (int) (OPEN + (CLOSED - OPEN) * pedal[i]) - 512};
+		replay.addFrame(values, 2);
+	}
+
+	return play(replay);
+}
+
+static std::vector<MidiEvent> select(const std::vector<MidiEvent>& events, int type, int data1, int from, int to) {
+	std::vector<MidiEvent> selected;
+
+	for (auto& event : events) {
+		if (event.type == type && event.data1 == data1 &&
+			event.time >= (unsigned long) from * MS && event.time < (unsigned long) to * MS) {
+			selected.push_back(event);
+		}
+	}
+
+	return selected;
+}
+
+
+//
+//	Sweeping the pedal sends its position as CC4, at most every HIHAT_INTERVAL
+//	ms and only when it moves, and fast moves chick and splash
+//
+
+TEST(hihat) {
+	bow.assign(5000 * MS, 0);
+	pedal.assign(5000 * MS, 0.0);
+
+	// open, then a fast close
+	strike(500, 400);
+	move(1000, 20, 1.0);
+	strike(1500, 400);
+
+	// a slow open (no splash)
+	move(2000, 500, 0.0);
+
+	// a fast close and open right after (chick and splash)
+	move(3000, 20, 1.0);
+	move(3080, 20, 0.0);
+
+	// a slow close (no chick)
+	move(4000, 400, 1.0);
+	strike(4700, 300);
+
+	std::vector<MidiEvent> events = playHihat();
+
+	// the bow plays the head note while open and the rim note while closed
+	CHECK(select(events, MIDI_NOTE_ON, BOW_NOTE, 0, 5000).size() == 1);
+	CHECK(select(events, MIDI_NOTE_ON, BOW_NOTE, 500, 510).size() == 1);
+	CHECK(select(events, MIDI_NOTE_ON, CLOSED_NOTE, 0, 5000).size() == 2);
+	CHECK(select(events, MIDI_NOTE_ON, CLOSED_NOTE, 1500, 1510).size() == 1);
+	CHECK(select(events, MIDI_NOTE_ON, CLOSED_NOTE, 4700, 4710).size() == 1);
+
+	// fast closes chick, opening right after splashes, slow moves are silent
+	std::vector<MidiEvent> chicks = select(events, MIDI_NOTE_ON, HIHAT_CHICK_NOTE, 0, 5000);
+	std::vector<MidiEvent> splashes = select(events, MIDI_NOTE_ON, HIHAT_SPLASH_NOTE, 0, 5000);
+
+	if (CHECK(chicks.size() == 2 && splashes.size() == 1)) {
+		CHECK(chicks[0].time >= 1000 * MS && chicks[0].time < 1040 * MS && chicks[0].data2 > 0);
+		CHECK(chicks[1].time >= 3000 * MS && chicks[1].time < 3040 * MS && chicks[1].data2 > 0);
+		CHECK(splashes[0].time >= 3080 * MS && splashes[0].time < 3120 * MS && splashes[0].data2 > 0);
+	}
+
+	// CC4 is rate limited and stays quiet while the pedal doesn't move
+	std::vector<MidiEvent> positions = select(events, MIDI_CONTROL_CHANGE, 4, 0, 5000);
+
+	for (size_t i = 1; i < positions.size(); i++) {
+		CHECK(positions[i].time - positions[i - 1].time >= (unsigned long) HIHAT_INTERVAL * MS);
+	}
+
+	CHECK(select(events, MIDI_CONTROL_CHANGE, 4, 100, 1000).size() == 0);
+	CHECK(select(events, MIDI_CONTROL_CHANGE, 4, 1100, 2000).size() == 0);
+	CHECK(select(events, MIDI_CONTROL_CHANGE, 4, 4500, 5000).size() == 0);
+
+	// the slow open sweeps down step by step (one send per interval) and ends open
+	std::vector<MidiEvent> sweep = select(events, MIDI_CONTROL_CHANGE, 4, 2000, 2600);
+
+	if (CHECK(sweep.size() >= 40 && sweep.size() <= 500 / HIHAT_INTERVAL + 2)) {
+		for (size_t i = 1; i < sweep.size(); i++) {
+			CHECK(sweep[i].data2 < sweep[i - 1].data2);
+			CHECK(sweep[i - 1].data2 - sweep[i].data2 <= 4);
+		}
+
+		CHECK(sweep.front().data2 < 127 && sweep.back().data2 == 0);
+	}
+
+	// and the slow close sweeps up and ends closed
+	sweep = select(events, MIDI_CONTROL_CHANGE, 4, 4000, 4500);
+
+	if (CHECK(sweep.size() >= 30)) {
+		for (size_t i = 1; i < sweep.size(); i++) {
+			CHECK(sweep[i].data2 > sweep[i - 1].data2);
+		}
+
+		CHECK(sweep.back().data2 == 127);
+	}
+
+	// the fast moves reach both ends
+	CHECK(select(events, MIDI_CONTROL_CHANGE, 4, 1000, 1100).back().data2 == 127);
+	CHECK(select(events, MIDI_CONTROL_CHANGE, 4, 3080, 3200).back().data2 == 0);
+}
@@ -0,0 +1,119 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include <usb_midi.h>
+
+#include "kit.h"
+
+#include "player.h"
+#include "test.h"
+#include "type.h"
+
+
+//
+//	A pad with an invalid head sensor and a valid rim only plays its rim
+//	(the sensor its head falls back to belongs to another pad)
+//
+
+TEST(kitInvalidHead) {
+	static const int MS = SAMPLING_RATE / 1000;
+	resetPads();
+
+	// pad 2 has its rim on sensor 3, pad 3 (which would use that sensor) is off
+	Properties properties = getPad(2);
+	properties.headSensor = 0;
+	properties.headNote = 69;
+	properties.zones = DUAL_ZONE;
+	properties.rimSensor = 3;
+	properties.rimNote = 70;
+	setPad(2, properties);
+
+	properties = getPad(3);
+	properties.headSensor = 0;
+	setPad(3, properties);
+
+	// strike pad 1 hard and the rim of pad 2 softly at the same time
+	Replay replay;
+
+	for (auto i = 0; i < 500 * MS; i++) {
+		double t = (double) i / SAMPLING_RATE;
+		double wave = exp(-t / 0.015) * sin(2 * M_PI * 300 * t);
+		int values[3] = {(int) (450 * wave), 0, (int) (150 * wave)};
+		replay.addFrame(values, 3);
+	}
+
+	std::vector<MidiEvent> events = play(replay);
+	int pad1 = 0;
+	int rim = 0;
+	int head = 0;
+
+	for (auto& event : events) {
+		if (event.type == MIDI_NOTE_ON) {
+			pad1 += event.data1 == getPad(1).headNote;
+			rim += event.data1 == 70;
+			head += event.data1 == 69;
+		}
+	}
+
+	CHECK(pad1 == 1);
+	CHECK(rim == 1);
+	CHECK(head == 0);
+	resetPads();
+}
+
+
+//
+//	A configuration request sent after a pad update reports the update
+//	(both are handled in the background, whether or not detection has
+//	switched to it yet)
+//
+
+TEST(kitConfigRequest) {
+	resetPads();
+	Kit kit;
+	kit.loadSettings();
+
+	Properties properties = getPad(2);
+	properties.headThreshold = 33;
+	properties.headNote = 61;
+	usbMIDI.sysex.clear();
+	properties.sendAsMidi(MIDI_UPDATE_PAD, 2);
+
+	if (CHECK(usbMIDI.sysex.size() == 1)) {
+		std::vector<uint8_t> update = usbMIDI.sysex[0];
+		CHECK(kit.midiRequest(update.data(), update.size()));
+
+		uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_REQUEST_CONFIG, 0xf7};
+		usbMIDI.sysex.clear();
+		CHECK(kit.midiRequest(request, sizeof(request)));
+
+		// the reply holds pad 2 as it was sent
+		int found = 0;
+
+		for (auto& msg : usbMIDI.sysex) {
+			if (msg.size() == update.size() && msg[2] == MIDI_SEND_PAD && msg[3] == 2) {
+				Properties reply;
+				CHECK(reply.receiveFromMidi(msg.data(), msg.size()));
+				CHECK(reply.headThreshold == 33 && reply.headNote == 61);
+				found++;
+			}
+		}
+
+		CHECK(found == 1);
+	}
+
+	// crosstalk changes are left to detection
+	uint8_t crosstalk[] = {0xf0, MIDI_VENDOR_ID, MIDI_UPDATE_CROSSTALK, 1, 2, 64, 0xf7};
+	CHECK(!kit.midiRequest(crosstalk, sizeof(crosstalk)));
+	resetPads();
+}
@@ -0,0 +1,80 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <string.h>
+
+#include "test.h"
+
+
+//
+//	Globals
+//
+
+static Test* tests = nullptr;
+static Test* last = nullptr;
+static int failures = 0;
+
+
+//
+//	Test::Test
+//
+
+Test::Test(const char* name, void (*function)()) : name(name), function(function), next(nullptr) {
+	// keep tests in the order they were defined
+	(last ? last->next : tests) = this;
+	last = this;
+}
+
+
+//
+//	Report a failed condition
+//
+
+bool checkCondition(bool condition, const char* text, const char* file, int line) {
+	if (!condition) {
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+		failures++;
+	}
+
+	return condition;
+}
+
+
+//
+//	Main function (runs all tests or the ones named on the command line)
+//
+
+int main(int argc, char* argv[]) {
+	int run = 0;
+	int failed = 0;
+
+	for (auto test = tests; test; test = test->next) {
+		bool selected = argc == 1;
+
+		for (auto i = 1; i < argc; i++) {
+			selected |= !strcmp(argv[i], test->name);
+		}
+
+		if (selected) {
+			int before = failures;
+			test->function();
+			run++;
+
+			if (failures != before) {
+				fprintf(stderr, "%s: FAILED\n", test->name);
+				failed++;
+			}
+		}
+	}
+
+	fprintf(stderr, "tests: %d run, %d failed\n", run, failed);
+	return failed ? 1 : 0;
+}
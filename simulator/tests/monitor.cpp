@@ -0,0 +1,190 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <vector>
+
+#include <usb_midi.h>
+
+#include "arena.h"
+#include "monitor.h"
+#include "packer.h"
+#include "test.h"
+
+
+//
+//	Session as the control app receives it
+//
+
+struct Session {
+	int pad = 0;
+	int size = -1;
+	int pretrigger = -1;
+	int ends = 0;
+	bool packed = false;
+	std::vector<int> values;
+};
+
+static Session receive() {
+	Session session;
+
+	for (auto& msg : usbMIDI.sysex) {
+		if (msg[2] == MIDI_MONITOR_START) {
+			session.pad = msg[3];
+			session.size = (msg[5] << 7) | msg[6];
+			session.pretrigger = (msg[7] << 7) | msg[8];
+
+		} else if (msg[2] == MIDI_MONITOR_DATA || msg[2] == MIDI_MONITOR_PACKED) {
+			int size = (msg[7] << 7) | msg[8];
+			session.pad = msg[3] == session.pad ? session.pad : -1;
+
+			if (msg[2] == MIDI_MONITOR_PACKED) {
+				std::vector<int16_t> values(size);
+				unpack(msg.data() + 9, msg.size() - 10, values.data(), size);
+				session.values.insert(session.values.end(), values.begin(), values.end());
+				session.packed = true;
+
+			} else {
+				for (auto i = 0; i < size; i++) {
+					session.values.push_back(((msg[9 + 2 * i] << 7) | msg[10 + 2 * i]) - 1024);
+				}
+			}
+
+		} else if (msg[2] == MIDI_MONITOR_END) {
+			session.pad = msg[3] == session.pad ? session.pad : -1;
+			session.ends++;
+		}
+	}
+
+	return session;
+}
+
+
+//
+//	Record 100 samples of history and capture 60 on pad 1
+//
+
+static void capture(Monitor& monitor) {
+	for (auto i = 0; i < 100; i++) {
+		monitor.record(i);
+	}
+
+	monitor.start(1, 1);
+
+	for (auto i = 0; i < 60; i++) {
+		monitor.sample(1, 1000 + i);
+	}
+
+	monitor.end(1);
+	usbMIDI.sysex.clear();
+}
+
+
+//
+//	The requested number of pre-trigger samples (data[5..6]) goes in front
+//	of the session, a request without it gives none
+//
+
+TEST(monitorPretrigger) {
+	Arena arena;
+	Monitor monitor(&arena);
+	uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 1, 0, 40, ENCODING_RAW, 0xf7};
+	monitor.midiEvent(request, sizeof(request));
+	capture(monitor);
+	monitor.transmit(100000);
+
+	Session session = receive();
+	CHECK(session.pad == 1);
+	CHECK(session.size == 100 && session.pretrigger == 40 && session.ends == 1);
+
+	if (CHECK(session.values.size() == 100)) {
+		for (auto i = 0; i < 40; i++) {
+			CHECK(session.values[i] == 60 + i);
+		}
+
+		for (auto i = 0; i < 60; i++) {
+			CHECK(session.values[40 + i] == 1000 + i);
+		}
+	}
+
+	// longer requests are limited to the history, short ones have none
+	uint8_t longer[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 1, 3, 0, 0xf7};
+	monitor.midiEvent(longer, sizeof(longer));
+	capture(monitor);
+	monitor.transmit(100000);
+	session = receive();
+	CHECK(session.pretrigger == 100 && session.values.size() == 160 && session.values[0] == 0);
+
+	uint8_t none[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 1, 0xf7};
+	monitor.midiEvent(none, sizeof(none));
+	capture(monitor);
+	monitor.transmit(100000);
+	session = receive();
+	CHECK(session.pretrigger == 0 && session.values.size() == 60 && session.values[0] == 1000);
+}
+
+
+//
+//	A session sent with the smallest budget per call comes out the same as
+//	one sent in one go, without going over the budget
+//
+
+TEST(monitorResume) {
+	Arena arena;
+	Monitor monitor(&arena);
+	uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 1, 0, 40, ENCODING_RAW, 0xf7};
+	monitor.midiEvent(request, sizeof(request));
+	capture(monitor);
+	monitor.transmit(100000);
+	Session whole = receive();
+
+	capture(monitor);
+	int calls = 0;
+
+	while (calls < 100) {
+		size_t sent = usbMIDI.sysexBytes;
+		int left = monitor.transmit(MONITOR_MESSAGE_SIZE);
+		CHECK(left >= 0 && usbMIDI.sysexBytes - sent == (size_t) (MONITOR_MESSAGE_SIZE - left));
+
+		if (left == MONITOR_MESSAGE_SIZE) {
+			break;
+		}
+
+		calls++;
+	}
+
+	Session resumed = receive();
+	CHECK(calls > 3);
+	CHECK(resumed.ends == 1 && resumed.size == whole.size && resumed.values == whole.values);
+}
+
+
+//
+//	A request that comes in while a session is sent doesn't change the pad
+//	or the encoding of the rest of it
+//
+
+TEST(monitorSnapshot) {
+	Arena arena;
+	Monitor monitor(&arena);
+	uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 1, 0, 40, ENCODING_RAW, 0xf7};
+	monitor.midiEvent(request, sizeof(request));
+	capture(monitor);
+
+	monitor.transmit(MONITOR_MESSAGE_SIZE);
+	uint8_t change[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 2, 0, 40, ENCODING_PACKED, 0xf7};
+	monitor.midiEvent(change, sizeof(change));
+
+	while (monitor.transmit(MONITOR_MESSAGE_SIZE) != MONITOR_MESSAGE_SIZE) {
+	}
+
+	Session session = receive();
+	CHECK(session.pad == 1 && !session.packed && session.ends == 1 && session.values.size() == 100);
+}
@@ -0,0 +1,109 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <Arduino.h>
+#include <usb_midi.h>
+
+#include "arena.h"
+#include "context.h"
+#include "core.h"
+#include "oscilloscope.h"
+#include "replay.h"
+#include "scanner.h"
+#include "test.h"
+
+
+//
+//	Points sent in stream messages (and the time they were sent in microseconds)
+//
+
+struct Sent {
+	int count;
+	unsigned long time;
+};
+
+static std::vector<Sent> streamed(size_t& first) {
+	std::vector<Sent> sent;
+
+	for (; first < usbMIDI.sysex.size(); first++) {
+		auto& msg = usbMIDI.sysex[first];
+
+		if (msg.size() > 6 && msg[2] == MIDI_OSCILLOSCOPE_STREAM) {
+			sent.push_back({msg[5], micros()});
+		}
+	}
+
+	return sent;
+}
+
+
+//
+//	A stream that stops sends its last points once they waited long enough
+//
+
+TEST(oscilloscopeStreamFlush) {
+	Replay replay;
+	int values[NUMBER_OF_SENSORS] = {0};
+
+	for (auto i = 0; i < 300; i++) {
+		values[0] = i % 100;
+		replay.addFrame(values, NUMBER_OF_SENSORS);
+	}
+
+	replay.attach();
+
+	Arena arena;
+	Oscilloscope oscilloscope(&arena);
+	Context context;
+	context.scanner = new Scanner();
+
+	// stream sensor 1 at one point per millisecond
+	uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_OSCILLOSCOPE_REQUEST, 1, 1, 0, 0, 0, ENCODING_RAW,
+		OSCILLOSCOPE_STREAM, 1, OSCILLOSCOPE_EITHER, 0, 0, 0, 0, SAMPLING_RATE / 1000, 0xf7};
+	oscilloscope.midiEvent(request, sizeof(request));
+
+	usbMIDI.sysex.clear();
+	resetClock();
+	size_t checked = 0;
+	int points = 0;
+	unsigned long last = 0;
+
+	// 15 points come in, a full message would take 25
+	while (replay.next()) {
+		advanceClock(1000000 / SAMPLING_RATE);
+		context.scanner->start();
+		context.scanner->read();
+		oscilloscope.process(&context);
+		oscilloscope.transmit(SYSEX_BUDGET);
+
+		for (auto& sent : streamed(checked)) {
+			points += sent.count;
+			last = sent.time;
+		}
+	}
+
+	// the first points waited their time and went out before the stream stopped
+	CHECK(points > 0 && points < 15);
+	CHECK(last >= (1 + OSCILLOSCOPE_STREAM_TIMEOUT) * 1000 && last <= (2 + OSCILLOSCOPE_STREAM_TIMEOUT) * 1000);
+
+	// the rest follows within the timeout
+	for (auto i = 0; i <= OSCILLOSCOPE_STREAM_TIMEOUT * 1000; i += 50) {
+		advanceClock(50);
+		oscilloscope.transmit(SYSEX_BUDGET);
+
+		for (auto& sent : streamed(checked)) {
+			points += sent.count;
+		}
+	}
+
+	CHECK(points == 15);
+	delete context.scanner;
+}
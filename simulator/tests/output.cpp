@@ -0,0 +1,169 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <usb_midi.h>
+
+#include "context.h"
+#include "core.h"
+#include "output.h"
+#include "properties.h"
+#include "test.h"
+
+
+//
+//	Hits queued after the background read its clock don't count as late
+//
+
+TEST(outputLatency) {
+	Output output;
+	HitQueue hits;
+
+	hits.push({1000, HIT_NOTE, 1, 38, 100, 0});
+	hits.push({1003, HIT_NOTE, 1, 38, 100, 0});
+	CHECK(output.drain(&hits, 1001) == 2);
+	CHECK(output.getLatency() == 1);
+
+	hits.push({1010, HIT_NOTE, 1, 38, 100, 0});
+	CHECK(output.drain(&hits, 1015) == 1);
+	CHECK(output.getLatency() == 5);
+}
+
+
+//
+//	Note offs follow their note on after the gate time (counted from the
+//	detection of the hit, not from when it was sent)
+//
+
+TEST(outputGate) {
+	static const int gates[] = {0, 1, 2, 50, MAX_GATE_TIME};
+	Output output;
+	HitQueue hits;
+
+	for (auto gate : gates) {
+		usbMIDI.events.clear();
+
+		// the hit waits 3 ticks in the queue
+		unsigned long start = 100000;
+		hits.push({start, HIT_NOTE, 1, 38, 100, (uint8_t) gate});
+
+		for (unsigned long now = start + 3; now < start + (MAX_GATE_TIME + 10) * SCHEDULER_RESOLUTION; now++) {
+			resetClock();
+			advanceClock(now - start);
+			output.drain(&hits, now);
+		}
+
+		if (CHECK(usbMIDI.events.size() == 2)) {
+			CHECK(usbMIDI.events[0].type == MIDI_NOTE_ON && usbMIDI.events[0].time == 3);
+			CHECK(usbMIDI.events[1].type == MIDI_NOTE_OFF && usbMIDI.events[1].data1 == 38);
+
+			// a zero gate sends the note off right away
+			unsigned long expected = gate ? gate * SCHEDULER_RESOLUTION : 3;
+			CHECK(usbMIDI.events[1].time == expected);
+		}
+	}
+}
+
+
+//
+//	Sixteen pads hit at the same time each get their own note off
+//
+
+TEST(outputGate16) {
+	Output output;
+	HitQueue hits;
+	usbMIDI.events.clear();
+
+	// pad n plays note 36 + n with a gate of 5 + 7 * n milliseconds
+	unsigned long start = 200000;
+
+	for (auto pad = 0; pad < 16; pad++) {
+		hits.push({start, HIT_NOTE, (uint8_t) pad, (uint8_t) (36 + pad), 100, (uint8_t) (5 + 7 * pad)});
+	}
+
+	for (unsigned long now = start; now < start + (MAX_GATE_TIME + 10) * SCHEDULER_RESOLUTION; now++) {
+		resetClock();
+		advanceClock(now - start);
+		output.drain(&hits, now);
+	}
+
+	if (CHECK(usbMIDI.events.size() == 32)) {
+		int offs = 0;
+
+		for (auto& event : usbMIDI.events) {
+			if (event.type == MIDI_NOTE_ON) {
+				CHECK(event.time == 0);
+
+			} else if (CHECK(event.type == MIDI_NOTE_OFF && event.data1 >= 36 && event.data1 < 52)) {
+				CHECK(event.time == (unsigned long) (5 + 7 * (event.data1 - 36)) * SCHEDULER_RESOLUTION);
+				offs++;
+			}
+		}
+
+		CHECK(offs == 16);
+	}
+}
+
+
+//
+//	A note hit again within its gate is held for the gate of the last hit
+//	(the note off of the earlier hit doesn't cut it short)
+//
+
+TEST(outputRetrigger) {
+	Output output;
+	HitQueue hits;
+	usbMIDI.events.clear();
+
+	unsigned long start = 300000;
+	hits.push({start, HIT_NOTE, 1, 38, 100, 50});
+
+	for (unsigned long now = start; now < start + 200 * SCHEDULER_RESOLUTION; now++) {
+		// hit again within the gate, and later once with a gate and once without
+		if (now == start + 30 * SCHEDULER_RESOLUTION) {
+			hits.push({now, HIT_NOTE, 1, 38, 90, 50});
+
+		} else if (now == start + 150 * SCHEDULER_RESOLUTION) {
+			hits.push({now, HIT_NOTE, 1, 38, 80, 50});
+
+		} else if (now == start + 170 * SCHEDULER_RESOLUTION) {
+			hits.push({now, HIT_NOTE, 1, 38, 70, 0});
+		}
+
+		resetClock();
+		advanceClock(now - start);
+		output.drain(&hits, now);
+	}
+
+	// the hit at 150ms loses its note off to the one at 170ms
+	if (CHECK(usbMIDI.events.size() == 6)) {
+		static const uint8_t types[] = {MIDI_NOTE_ON, MIDI_NOTE_ON, MIDI_NOTE_OFF, MIDI_NOTE_ON, MIDI_NOTE_ON, MIDI_NOTE_OFF};
+		static const int times[] = {0, 30, 80, 150, 170, 170};
+
+		for (auto i = 0; i < 6; i++) {
+			CHECK(usbMIDI.events[i].type == types[i]);
+			CHECK(usbMIDI.events[i].time == (unsigned long) times[i] * SCHEDULER_RESOLUTION);
+		}
+	}
+}
+
+
+//
+//	Gate times beyond a 7-bit sysex byte are capped when settings are loaded
+//
+
+TEST(outputGateLimit) {
+	Properties properties;
+	properties.loadSettings(0);
+	properties.gateTime = 200;
+	properties.saveSettings(0);
+	properties.loadSettings(0);
+	CHECK(properties.gateTime == MAX_GATE_TIME);
+}
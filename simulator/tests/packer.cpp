@@ -0,0 +1,244 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "packer.h"
+#include "test.h"
+
+
+//
+//	Pack samples into as many payloads as they need and unpack them again
+//	(returns false if a payload doesn't decode on its own or overflows)
+//
+
+static const int CAPACITY = 100;
+
+static bool roundTrip(const std::vector<int16_t>& samples, std::vector<int16_t>& result, size_t& bytes) {
+	result.clear();
+	bytes = 0;
+	size_t next = 0;
+
+	while (next < samples.size()) {
+		uint8_t payload[CAPACITY + 8];
+		memset(payload, 0xff, sizeof(payload));
+		Packer packer(payload, CAPACITY);
+		size_t first = next;
+
+		while (next < samples.size() && packer.add(samples[next])) {
+			next++;
+		}
+
+		// every payload takes at least one sample and stays within its capacity
+		int length = packer.finish();
+
+		if (next == first || length > CAPACITY || payload[CAPACITY] != 0xff) {
+			return false;
+		}
+
+		for (auto i = 0; i < length; i++) {
+			if (payload[i] & 0x80) {
+				return false;
+			}
+		}
+
+		// runs can cover any number of samples
+		std::vector<int16_t> values(samples.size());
+		int count = unpack(payload, length, values.data(), values.size());
+
+		if (count != (int) (next - first)) {
+			return false;
+		}
+
+		result.insert(result.end(), values.begin(), values.begin() + count);
+		bytes += length;
+	}
+
+	return true;
+}
+
+static bool same(const std::vector<int16_t>& samples) {
+	std::vector<int16_t> result;
+	size_t bytes;
+	return roundTrip(samples, result, bytes) && result == samples;
+}
+
+
+//
+//	Signals
+//
+
+static std::vector<int16_t> noise(std::mt19937& random, int count, int amplitude) {
+	std::uniform_int_distribution<int> uniform(-amplitude, amplitude);
+	std::vector<int16_t> samples;
+
+	for (auto i = 0; i < count; i++) {
+		samples.push_back(uniform(random));
+	}
+
+	return samples;
+}
+
+// an idle sensor: +-1 LSB of noise around a baseline that drifts a little
+static std::vector<int16_t> idle(std::mt19937& random, int count) {
+	std::normal_distribution<double> normal(0.0, 0.7);
+	std::vector<int16_t> samples;
+
+	for (auto i = 0; i < count; i++) {
+		samples.push_back((int16_t) lround(3 * sin(2 * M_PI * i / count) + normal(random)));
+	}
+
+	return samples;
+}
+
+static std::vector<int16_t> hit(int count, int amplitude) {
+	std::vector<int16_t> samples;
+
+	for (auto i = 0; i < count; i++) {
+		samples.push_back((int16_t) (amplitude * exp(-i / 120.0) * sin(2 * M_PI * 250 * i / 20000.0)));
+	}
+
+	return samples;
+}
+
+
+//
+//	Samples come back unchanged from their payloads
+//
+
+TEST(packerRoundTrip) {
+	std::mt19937 random(1);
+
+	// quiet to full scale noise and hits
+	for (auto amplitude : {0, 1, 3, 20, 511, 0x7fff}) {
+		CHECK(same(noise(random, 5000, amplitude)));
+		CHECK(same(hit(5000, amplitude)));
+	}
+
+	// long runs, alone and between changes
+	CHECK(same(std::vector<int16_t>(100000, 0)));
+	CHECK(same(std::vector<int16_t>(100000, -0x8000)));
+
+	std::vector<int16_t> runs;
+
+	for (auto i = 0; i < 50; i++) {
+		runs.insert(runs.end(), 1 << (i % 17), (int16_t) (i * 1000));
+	}
+
+	CHECK(same(runs));
+
+	// largest steps: +-0x7fff and full scale in both directions
+	CHECK(same({0x7fff, 0, 0x7fff, 0, -0x7fff, 0, -0x7fff}));
+	CHECK(same({-0x8000, 0x7fff, -0x8000, 0x7fff, 0x7fff, -0x8000, -0x8000}));
+
+	std::vector<int16_t> steps;
+
+	for (auto i = 0; i < 5000; i++) {
+		steps.push_back(random() % 2 ? 0x7fff : -0x8000);
+	}
+
+	CHECK(same(steps));
+}
+
+
+//
+//	A full payload refuses the next sample and stays decodable, the refused
+//	sample starts the next payload
+//
+
+TEST(packerFull) {
+	uint8_t payload[CAPACITY];
+	Packer packer(payload, CAPACITY);
+	std::vector<int16_t> added;
+	int16_t value = 0;
+
+	// full scale steps take 3 or 4 bytes each
+	while (packer.add(value)) {
+		added.push_back(value);
+		value = value == 0x7fff ? -0x8000 : 0x7fff;
+	}
+
+	CHECK(added.size() >= CAPACITY / 4 && added.size() <= CAPACITY / 3 + 1);
+	int length = packer.finish();
+	CHECK(length <= CAPACITY);
+
+	int16_t values[CAPACITY];
+	CHECK(unpack(payload, length, values, CAPACITY) == (int) added.size());
+	CHECK(std::vector<int16_t>(values, values + added.size()) == added);
+
+	// once refused, a run that would need another byte stays refused
+	Packer runs(payload, 2);
+	CHECK(runs.add(1));
+
+	for (auto i = 0; i < 15; i++) {
+		CHECK(runs.add(1));
+	}
+
+	CHECK(!runs.add(1));
+	CHECK(runs.finish() == 2);
+	CHECK(unpack(payload, 2, values, CAPACITY) == 16);
+
+	// small differences go out 5 to a 3 byte group, a partial group is
+	// refused once it would need another byte
+	Packer groups(payload, 5);
+	static const int small[] = {1, -2, 0, 3, 1, -1, 0, 2};
+
+	for (auto value : small) {
+		CHECK(groups.add(value));
+	}
+
+	CHECK(!groups.add(-3));
+	CHECK(groups.finish() == 5);
+	CHECK(unpack(payload, 5, values, CAPACITY) == 8);
+	CHECK(std::vector<int16_t>(values, values + 8) == std::vector<int16_t>(small, small + 8));
+
+	// malformed payloads are rejected
+	uint8_t truncated[] = {0x40};
+	CHECK(unpack(truncated, 1, values, CAPACITY) == -1);
+	CHECK(unpack(payload, 5, values, 6) == -1);
+}
+
+
+//
+//	Bytes per sample (raw takes 2), printed as a benchmark
+//
+
+TEST(packerRatio) {
+	std::mt19937 random(2);
+	struct {
+		const char* name;
+		std::vector<int16_t> samples;
+		double limit;
+	} signals[] = {
+		{"silence", std::vector<int16_t>(20000, 0), 0.1},
+		{"noise +-1", noise(random, 20000, 1), 0.7},
+		{"noise +-2", noise(random, 20000, 2), 1.0},
+		{"idle", idle(random, 20000), 0.7},
+		{"noise +-20", noise(random, 20000, 20), 1.5},
+		{"hit 400", hit(2000, 400), 1.5},
+		{"full scale", noise(random, 20000, 0x7fff), 3.5}
+	};
+
+	for (auto& signal : signals) {
+		std::vector<int16_t> result;
+		size_t bytes;
+		CHECK(roundTrip(signal.samples, result, bytes));
+
+		double ratio = (double) bytes / signal.samples.size();
+		printf("packer: %-12s %.3f bytes per sample\n", signal.name, ratio);
+		CHECK(ratio <= signal.limit);
+	}
+}
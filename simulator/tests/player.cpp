@@ -0,0 +1,88 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include "arena.h"
+#include "context.h"
+#include "core.h"
+#include "kit.h"
+#include "monitor.h"
+#include "output.h"
+#include "scanner.h"
+
+#include "player.h"
+
+
+//
+//	resetPads
+//
+
+void resetPads() {
+	Kit kit;
+	kit.saveSettings();
+}
+
+
+//
+//	getPad
+//
+
+Properties getPad(int pad) {
+	Properties properties;
+	properties.loadSettings((pad - 1) * MAX_BYTES_PER_PAD);
+	return properties;
+}
+
+
+//
+//	setPad
+//
+
+void setPad(int pad, Properties& properties) {
+	properties.saveSettings((pad - 1) * MAX_BYTES_PER_PAD);
+}
+
+
+//
+//	play
+//
+
+std::vector<MidiEvent> play(Replay& replay, unsigned long base) {
+	replay.attach();
+
+	Arena arena;
+	Context context;
+	context.scanner = new Scanner();
+	context.kit = new Kit();
+	context.monitor = new Monitor(&arena);
+	context.hits = new HitQueue();
+	context.kit->loadSettings();
+
+	Output output;
+	usbMIDI.events.clear();
+
+	for (auto i = 0; replay.next(); i++) {
+		context.scanner->start();
+		context.scanner->read();
+		context.now = base + i;
+		context.kit->process(&context);
+
+		// captured events are timed by the simulated clock (ticks since base)
+		resetClock();
+		advanceClock(i);
+		output.drain(context.hits, context.now);
+	}
+
+	delete context.hits;
+	delete context.monitor;
+	delete context.kit;
+	delete context.scanner;
+	return usbMIDI.events;
+}
@@ -0,0 +1,40 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <vector>
+
+#include <usb_midi.h>
+
+#include "properties.h"
+#include "replay.h"
+
+
+//
+//	Kit playback for tests
+//
+//	Tests change pad settings in EEPROM (starting from the defaults), and
+//	play() runs a fresh kit with those settings over a recording, just like
+//	the firmware would. Sent events are timed in sample ticks since the
+//	start of the recording, while the kit's clock starts at base.
+//
+
+// reset all pads to their defaults
+void resetPads();
+
+// get or change the settings of a pad (1 is the first pad)
+Properties getPad(int pad);
+void setPad(int pad, Properties& properties);
+
+// replay a recording through the kit and output (returns what was sent)
+std::vector<MidiEvent> play(Replay& replay, unsigned long base = 0);
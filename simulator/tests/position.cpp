@@ -0,0 +1,154 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <random>
+
+#include "player.h"
+#include "test.h"
+#include "type.h"
+
+
+//
+//	Strikes at known positions (0 is centre, 127 edge) on pad 1
+//
+//	Hits near the edge ring faster (150 Hz in the centre to 450 Hz at the
+//	edge) and reach the rim sensor (sensor 2) sooner: up to rimDelay ticks
+//	after the head in the centre (a negative delay has the rim lead). With
+//	steps, every other strike jumps up and decays without ringing, so it
+//	has neither a rise time nor a zero crossing.
+//
+
+static const int STRIKES = 300;
+static const int INTERVAL = SAMPLING_RATE / 5;
+static const int POSITION_CONTROL = 16;
+
+struct Strike {
+	int position;
+	int estimate;
+};
+
+static std::vector<Strike> playStrikes(unsigned int seed, bool rim, int rimDelay, bool steps = false) {
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	std::normal_distribution<double> noise(0.0, 2.0);
+
+	int frames = (STRIKES + 1) * INTERVAL;
+	std::vector<double> head(frames), edge(frames);
+	std::vector<Strike> strikes;
+
+	for (auto k = 1; k <= STRIKES; k++) {
+		double x = uniform(random);
+		int amplitude = 150 + (int) (uniform(random) * 330);
+		double frequency = 150 + 300 * x;
+		int delay = (int) round((1 - x) * rimDelay);
+		int start = k * INTERVAL;
+
+		for (auto i = 0; i < SAMPLING_RATE * 40 / 1000; i++) {
+			double t = (double) i / SAMPLING_RATE;
+			double v = amplitude * exp(-t / 0.006) * (steps && k % 2 ? 1.0 : sin(2 * M_PI * frequency * t));
+			head[start + i] += v;
+
+			if (start + i + delay >= 0 && start + i + delay < frames) {
+				edge[start + i + delay] += 0.3 * v;
+			}
+		}
+
+		strikes.push_back({(int) round(127 * x), -1});
+	}
+
+	// pad 1 sends positions, pad 2 would use the rim sensor as its head
+	resetPads();
+	Properties properties = getPad(1);
+	properties.positionControl = POSITION_CONTROL;
+
+	if (rim) {
+		properties.zones = DUAL_ZONE;
+		properties.rimSensor = 2;
+	}
+
+	setPad(1, properties);
+	properties = getPad(2);
+	properties.headSensor = 0;
+	setPad(2, properties);
+
+	Replay replay;
+
+	for (auto i = 0; i < frames; i++) {
+		int values[2] = {(int) (head[i] + noise(random)), (int) (edge[i] + noise(random))};
+		replay.addFrame(values, 2);
+	}
+
+	// match positions to the strike they were sent for
+	for (auto& event : play(replay)) {
+		if (event.type == MIDI_CONTROL_CHANGE && event.data1 == POSITION_CONTROL) {
+			int k = (int) ((event.time + INTERVAL / 2) / INTERVAL) - 1;
+
+			if (k >= 0 && k < STRIKES) {
+				strikes[k].estimate = event.data2;
+			}
+		}
+	}
+
+	return strikes;
+}
+
+static double averageError(const std::vector<Strike>& strikes) {
+	double total = 0.0;
+
+	for (auto& strike : strikes) {
+		total += abs(strike.estimate - strike.position);
+	}
+
+	return total / strikes.size();
+}
+
+static bool allEstimated(const std::vector<Strike>& strikes) {
+	for (auto& strike : strikes) {
+		if (strike.estimate < 0 || strike.estimate > 127) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//
+//	Estimates are well below the error of a guess (about 42), with and
+//	without a rim sensor
+//
+
+TEST(position) {
+	for (unsigned int seed = 1; seed <= 2; seed++) {
+		std::vector<Strike> strikes = playStrikes(seed, false, 0);
+		CHECK(allEstimated(strikes));
+		CHECK(averageError(strikes) < 24.0);
+
+		strikes = playStrikes(seed, true, 10);
+		CHECK(allEstimated(strikes));
+		CHECK(averageError(strikes) < 24.0);
+	}
+}
+
+
+//
+//	Hits without timing to go by and a rim that sees hits well before the
+//	head still give positions in range
+//
+
+TEST(positionLimits) {
+	CHECK(allEstimated(playStrikes(3, false, 0, true)));
+	CHECK(allEstimated(playStrikes(3, true, 10, true)));
+	CHECK(allEstimated(playStrikes(3, true, -60)));
+}
@@ -0,0 +1,147 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "player.h"
+#include "test.h"
+
+
+//
+//	Synthetic corpus of 10 s of hits on all pads (distinct notes per pad)
+//
+
+static const int MS = SAMPLING_RATE / 1000;
+static const int PADS = 16;
+static const int NOTE = 36;
+
+static uint32_t seed;
+
+static int random(int low, int high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (int) ((seed >> 8) % (uint32_t) (high - low + 1));
+}
+
+static Replay corpus() {
+	std::vector<std::vector<double>> signals(PADS, std::vector<double>(10000 * MS, 0.0));
+	seed = 2;
+
+	for (auto& signal : signals) {
+		for (int t = random(0, 500 * MS); t < (int) signal.size(); t += random(250 * MS, 1000 * MS)) {
+			int amplitude = random(60, 480);
+
+			for (auto i = 0; i < 30 * MS && t + i < (int) signal.size(); i++) {
+				double x = (double) i / SAMPLING_RATE;
+				signal[t + i] += amplitude * exp(-x / 0.006) * sin(2 * M_PI * 180 * x);
+			}
+		}
+	}
+
+	Replay replay;
+
+	for (size_t i = 0; i < signals[0].size(); i++) {
+		int values[PADS];
+
+		for (auto c = 0; c < PADS; c++) {
+			values[c] = (int) signals[c][i] + random(-2, 2);
+		}
+
+		replay.addFrame(values, PADS);
+	}
+
+	return replay;
+}
+
+static std::vector<MidiEvent> playCorpus(Replay& replay, int predictTime) {
+	resetPads();
+
+	for (auto pad = 1; pad <= PADS; pad++) {
+		Properties properties = getPad(pad);
+		properties.headNote = NOTE + pad - 1;
+		properties.predictTime = predictTime;
+		setPad(pad, properties);
+	}
+
+	std::vector<MidiEvent> notes;
+
+	for (auto& event : play(replay)) {
+		if (event.type == MIDI_NOTE_ON) {
+			notes.push_back(event);
+		}
+	}
+
+	return notes;
+}
+
+
+//
+//	Predicted notes are matched with the first later note on the same key
+//	sent after the full scan window
+//
+
+struct Comparison {
+	size_t matched;
+	double saved;
+	double error;
+	int worst;
+};
+
+static Comparison compare(const std::vector<MidiEvent>& predicted, const std::vector<MidiEvent>& reference) {
+	std::vector<bool> used(reference.size());
+	Comparison comparison = {0, 0.0, 0.0, 0};
+
+	for (auto& note : predicted) {
+		for (size_t i = 0; i < reference.size(); i++) {
+			auto& event = reference[i];
+
+			if (!used[i] && event.data1 == note.data1 && event.time >= note.time && event.time - note.time < 10 * MS) {
+				int error = abs(event.data2 - note.data2);
+				used[i] = true;
+				comparison.matched++;
+				comparison.saved += (double) (event.time - note.time) / MS;
+				comparison.error += error;
+				comparison.worst = error > comparison.worst ? error : comparison.worst;
+				break;
+			}
+		}
+	}
+
+	if (comparison.matched) {
+		comparison.saved /= comparison.matched;
+		comparison.error /= comparison.matched;
+	}
+
+	return comparison;
+}
+
+
+//
+//	Prediction sends every note early, a longer predict time saves less
+//	latency but gets closer to the full window velocity
+//
+
+TEST(predict) {
+	Replay replay = corpus();
+	std::vector<MidiEvent> reference = playCorpus(replay, 0);
+	std::vector<MidiEvent> early = playCorpus(replay, 1);
+	std::vector<MidiEvent> later = playCorpus(replay, 2);
+
+	Comparison first = compare(early, reference);
+	Comparison second = compare(later, reference);
+	CHECK(reference.size() > 200);
+	CHECK(early.size() == reference.size() && first.matched == reference.size());
+	CHECK(later.size() == reference.size() && second.matched == reference.size());
+
+	// latency saved (ms) and velocity error (average and worst)
+	CHECK(first.saved > 1.5 && first.error < 3.0 && first.worst <= 24);
+	CHECK(second.saved > 0.75 && second.error < 1.0 && second.worst <= 16);
+	CHECK(first.saved > second.saved && first.error > second.error);
+}
@@ -0,0 +1,143 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "player.h"
+#include "test.h"
+
+
+//
+//	Synthetic corpus of strokes on pad 1 (sensor 1) with the default settings
+//	(3 ms scan, 5 ms mask and 40 ms retrigger)
+//
+
+static const int MS = SAMPLING_RATE / 1000;
+static const int NOTE = 48;
+
+struct Stroke {
+	int time;
+	int amplitude;
+	bool real;
+};
+
+static uint32_t seed;
+
+static int random(int low, int high) {
+	seed = seed * 1664525 + 1013904223;
+	return low + (int) ((seed >> 8) % (uint32_t) (high - low + 1));
+}
+
+static std::vector<Stroke> corpus() {
+	std::vector<Stroke> strokes;
+	seed = 11;
+	int t = 100 * MS;
+
+	for (auto k = 0; k < 20; k++) {
+		// loud hit with a stick bounce 22-30 ms later (not a real hit)
+		int amplitude = random(380, 500);
+		strokes.push_back({t, amplitude, true});
+		strokes.push_back({t + random(22 * MS, 30 * MS), amplitude * random(20, 30) / 100, false});
+		t += 250 * MS;
+
+		// roll of 8 strokes 28-33 ms apart
+		for (auto s = 0; s < 8; s++) {
+			strokes.push_back({t, random(180, 300), true});
+			t += random(28 * MS, 33 * MS);
+		}
+
+		t += 200 * MS;
+
+		// flam: soft grace note followed 15-25 ms later by a full stroke
+		strokes.push_back({t, random(120, 220), true});
+		strokes.push_back({t + random(15 * MS, 25 * MS), random(350, 480), true});
+		t += 300 * MS;
+
+		// tight flam: the full stroke lands in the mask of the grace note
+		strokes.push_back({t, random(100, 200), true});
+		strokes.push_back({t + random(5 * MS, 7 * MS), random(350, 480), true});
+		t += 300 * MS;
+	}
+
+	return strokes;
+}
+
+static std::vector<MidiEvent> playCorpus(const std::vector<Stroke>& strokes) {
+	std::vector<double> signal(strokes.back().time + 200 * MS, 0.0);
+
+	for (auto& stroke : strokes) {
+		for (auto i = 0; i < 60 * MS && stroke.time + i < (int) signal.size(); i++) {
+			double t = (double) i / SAMPLING_RATE;
+			signal[stroke.time + i] += stroke.amplitude * exp(-t / 0.007) * sin(2 * M_PI * 170 * t);
+		}
+	}
+
+	resetPads();
+	Replay replay;
+
+	for (auto& value : signal) {
+		int values[1] = {(int) value + random(-2, 2)};
+		replay.addFrame(values, 1);
+	}
+
+	return play(replay);
+}
+
+
+//
+//	Strokes are matched with the first unused note within 5 ms (the scan
+//	window and then some), notes that don't belong to one are retriggers
+//
+
+TEST(retrigger) {
+	std::vector<Stroke> strokes = corpus();
+	std::vector<MidiEvent> events = playCorpus(strokes);
+	std::vector<bool> used(events.size());
+	int missed = 0;
+	int tight = 0;
+
+	for (size_t s = 0; s < strokes.size(); s++) {
+		if (!strokes[s].real) {
+			continue;
+		}
+
+		bool found = false;
+
+		for (size_t i = 0; i < events.size() && !found; i++) {
+			auto& event = events[i];
+
+			if (!used[i] && event.type == MIDI_NOTE_ON && event.data1 == NOTE &&
+				event.time >= (unsigned long) strokes[s].time && event.time < (unsigned long) strokes[s].time + 5 * MS) {
+				used[i] = true;
+				found = true;
+			}
+		}
+
+		missed += !found;
+
+		// the full stroke of a tight flam is the second of a pair less than 8 ms apart
+		if (found && s && strokes[s].time - strokes[s - 1].time < 8 * MS) {
+			tight++;
+		}
+	}
+
+	int extra = 0;
+
+	for (size_t i = 0; i < events.size(); i++) {
+		extra += !used[i] && events[i].type == MIDI_NOTE_ON;
+	}
+
+	// a stroke louder than the last peak gets through the mask, ringing and
+	// bounces stay below the envelope
+	CHECK(missed == 0);
+	CHECK(tight == 20);
+	CHECK(extra <= 1);
+}
@@ -0,0 +1,224 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "player.h"
+#include "replay.h"
+#include "scanner.h"
+#include "test.h"
+
+
+//
+//	Frames handed off by the scanner (counted by the frame handler)
+//
+
+static int handled = 0;
+
+
+//
+//	Make a recording where sensor 1 holds the frame number and sensor 9
+//	(the other input of the first ADC pair) its negative
+//
+
+static void makeRecording(Replay& replay, int frames) {
+	int values[NUMBER_OF_SENSORS] = {0};
+
+	for (auto i = 0; i < frames; i++) {
+		values[0] = i;
+		values[8] = -i;
+		replay.addFrame(values, NUMBER_OF_SENSORS);
+	}
+
+	replay.attach();
+}
+
+
+//
+//	Every frame is handed to the reader in order
+//
+
+TEST(scannerHandoff) {
+	Replay replay;
+	makeRecording(replay, 100);
+
+	Scanner scanner;
+	scanner.setFrameHandler([]() { handled++; });
+	handled = 0;
+	unsigned long first = 0;
+
+	for (auto i = 0; i < 100; i++) {
+		replay.next();
+		scanner.start();
+
+		CHECK(scanner.available());
+		CHECK(handled == i + 1);
+		scanner.read();
+		CHECK(!scanner.available());
+
+		// the current frame and the ones before it stay where they were converted
+		CHECK(scanner.getFrame()[0] == i);
+		CHECK(scanner.getValue(9) == -i);
+
+		// frames are timed by the sample tick they were started at
+		if (i == 0) {
+			first = scanner.getTime();
+
+		} else {
+			CHECK(scanner.getTime() - first == (unsigned long) i);
+		}
+
+		for (auto age = 1; age <= SCANNER_HISTORY - 2 && age <= i; age++) {
+			CHECK(scanner.getValue(1, age) == i - age);
+			CHECK(scanner.getFrame(age)[8] == age - i);
+		}
+	}
+	CHECK(scanner.getOverruns() == 0);
+}
+
+
+//
+//	Frames that aren't picked up are overrun, the reader gets the latest one
+//	and the history still holds the frames before it
+//
+
+TEST(scannerOverrun) {
+	Replay replay;
+	makeRecording(replay, SCANNER_HISTORY + 1);
+
+	Scanner scanner;
+	scanner.setFrameHandler([]() { handled++; });
+	handled = 0;
+
+	// produce a full ring of frames without reading any of them
+	for (auto i = 0; i < SCANNER_HISTORY; i++) {
+		replay.next();
+		scanner.start();
+	}
+
+	CHECK(handled == SCANNER_HISTORY);
+	CHECK(scanner.getOverruns() == SCANNER_HISTORY - 1);
+	CHECK(scanner.available());
+
+	scanner.read();
+	CHECK(scanner.getFrame()[0] == SCANNER_HISTORY - 1);
+
+	for (auto age = 1; age <= SCANNER_HISTORY - 2; age++) {
+		CHECK(scanner.getValue(1, age) == SCANNER_HISTORY - 1 - age);
+	}
+
+	// and carries on normally after that
+	replay.next();
+	scanner.start();
+	scanner.read();
+
+	CHECK(scanner.getFrame()[0] == SCANNER_HISTORY);
+	CHECK(scanner.getValue(1, 1) == SCANNER_HISTORY - 1);
+	CHECK(scanner.getOverruns() == SCANNER_HISTORY - 1);
+}
+
+
+//
+//	The baseline of an idle sensor follows a slow DC ramp (a sensor that
+//	is handling a hit keeps its baseline where it was)
+//
+
+TEST(scannerDrift) {
+	// 200 steps up over 20 s with a hit on top halfway
+	const int frames = 20 * SAMPLING_RATE;
+	const int hit = 10 * SAMPLING_RATE;
+	Replay replay;
+	int values[1];
+
+	for (auto i = 0; i < frames; i++) {
+		values[0] = (int) ((int64_t) i * 200 / frames) + (i >= hit && i < hit + 100 ? 300 : 0);
+		replay.addFrame(values, 1);
+	}
+
+	replay.attach();
+	Scanner scanner;
+	int worst = 0;
+	int held = 0;
+
+	for (auto i = 0; i < frames; i++) {
+		replay.next();
+		scanner.start();
+		scanner.read();
+
+		if (i >= hit && i < hit + 100) {
+			// the hit isn't absorbed into the baseline while its pad handles it
+			CHECK(scanner.getOffset(1) == held);
+			CHECK(scanner.getValue(1) > 250);
+			scanner.track(~1u);
+
+		} else {
+			// the ramp lags by its slope times the time constant (about 8 steps)
+			int lag = (int) ((int64_t) i * 200 / frames) - (scanner.getOffset(1) - 512);
+			worst = lag > worst ? lag : worst;
+			scanner.track(~0u);
+			held = scanner.getOffset(1);
+		}
+	}
+
+	CHECK(worst >= 3 && worst <= 10);
+	CHECK(scanner.getOffset(1) - 512 >= 190);
+}
+
+
+//
+//	A kit on a drifting sensor doesn't play ghost notes and plays hits on
+//	top of the drift as it plays them without it (give or take the lag of
+//	the baseline)
+//
+
+static std::vector<MidiEvent> playDrift(int ramp) {
+	const int frames = 20 * SAMPLING_RATE;
+	Replay replay;
+
+	for (auto i = 0; i < frames; i++) {
+		int values[1] = {(int) ((int64_t) i * ramp / frames)};
+
+		// hits 5, 10 and 15 s in
+		for (auto t = 5; t < 20; t += 5) {
+			int start = t * SAMPLING_RATE;
+
+			if (i >= start && i < start + 30 * (SAMPLING_RATE / 1000)) {
+				double x = (double) (i - start) / SAMPLING_RATE;
+				values[0] += (int) ((40 + 16 * t) * exp(-x / 0.006) * sin(2 * M_PI * 180 * x));
+			}
+		}
+
+		replay.addFrame(values, 1);
+	}
+
+	resetPads();
+	std::vector<MidiEvent> notes;
+
+	for (auto& event : play(replay)) {
+		if (event.type == MIDI_NOTE_ON) {
+			notes.push_back(event);
+		}
+	}
+
+	return notes;
+}
+
+TEST(scannerDriftHits) {
+	std::vector<MidiEvent> flat = playDrift(0);
+	std::vector<MidiEvent> drifting = playDrift(200);
+
+	if (CHECK(flat.size() == 3 && drifting.size() == 3)) {
+		for (auto i = 0; i < 3; i++) {
+			CHECK(drifting[i].time <= flat[i].time && flat[i].time - drifting[i].time <= 2);
+			CHECK(drifting[i].data2 >= flat[i].data2 && drifting[i].data2 - flat[i].data2 <= 5);
+		}
+	}
+}
@@ -0,0 +1,41 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+#pragma once
+
+
+//
+//	Include files
+//
+
+#include <stdio.h>
+
+
+//
+//	Host tests
+//
+//	Each TEST registers itself with the runner (main.cpp), CHECK reports a
+//	failed condition and lets the test carry on so all failures are shown.
+//
+
+struct Test {
+	Test(const char* name, void (*function)());
+
+	const char* name;
+	void (*function)();
+	Test* next;
+};
+
+#define TEST(name) \
+	static void name(); \
+	static Test name##Test(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	checkCondition(condition, #condition, __FILE__, __LINE__)
+
+bool checkCondition(bool condition, const char* text, const char* file, int line);
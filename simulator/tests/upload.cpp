@@ -0,0 +1,191 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <limits.h>
+#include <math.h>
+
+#include <Arduino.h>
+#include <usb_midi.h>
+
+#include "arena.h"
+#include "context.h"
+#include "core.h"
+#include "kit.h"
+#include "monitor.h"
+#include "output.h"
+#include "player.h"
+#include "scanner.h"
+#include "test.h"
+
+
+//
+//	Firmware contexts on simulated time: the scan timer interrupts the
+//	background (also while it waits for the USB link) and detection runs on
+//	every completed frame, like the software interrupt does
+//
+
+static const int TICK = 1000000 / SAMPLING_RATE;
+static const int MS = SAMPLING_RATE / 1000;
+
+static Replay* replay;
+static Context context;
+static bool done;
+
+static unsigned long ticks;
+static unsigned long frames;
+static unsigned long gaps;
+
+static void scanTick() {
+	if (done || !replay->next()) {
+		done = true;
+		return;
+	}
+
+	ticks++;
+	context.scanner->start();
+
+	if (context.scanner->available()) {
+		context.scanner->read();
+
+		// every tick should give the next frame
+		if (frames && context.scanner->getTime() != context.now + 1) {
+			gaps++;
+		}
+
+		context.now = context.scanner->getTime();
+		context.kit->process(&context);
+		frames++;
+	}
+}
+
+
+//
+//	Pad 1 is monitored and struck every 140 ms, the other pads are struck
+//	every 8 ms, one after the other, so a hit is detected every half
+//	millisecond. The background sends at most budget sysex bytes per pass
+//	over a link that takes USB_MIDI_RATE.
+//
+
+struct Upload {
+	unsigned long overruns;
+	unsigned long longestPass;
+	unsigned long latency;
+	int sessions;
+	int notes;
+};
+
+static Upload upload(int budget) {
+	Replay recording;
+	int values[16];
+
+	for (auto i = 0; i < 1000 * MS; i++) {
+		for (auto pad = 0; pad < 16; pad++) {
+			int t = pad ? (i + pad * MS / 2) % (8 * MS) : i % (140 * MS);
+			values[pad] = (int) (300 * exp(-t / 10.0) * sin(2 * M_PI * 1000 * t / SAMPLING_RATE));
+		}
+
+		recording.addFrame(values, 16);
+	}
+
+	recording.attach();
+	replay = &recording;
+
+	resetPads();
+	Arena arena;
+	context.scanner = new Scanner();
+	context.kit = new Kit();
+	context.monitor = new Monitor(&arena);
+	context.hits = new HitQueue();
+	context.kit->loadSettings();
+	context.now = 0;
+
+	uint8_t request[] = {0xf0, MIDI_VENDOR_ID, MIDI_MONITOR_REQUEST, 1, 1, 0, 40, ENCODING_RAW, 0xf7};
+	context.monitor->midiEvent(request, sizeof(request));
+
+	Output output;
+	usbMIDI.events.clear();
+	usbMIDI.sysex.clear();
+	usbMIDI.linkRate = USB_MIDI_RATE;
+	usbMIDI.linkBytes = 0;
+	usbMIDI.linkTime = 0;
+
+	done = false;
+	ticks = 0;
+	frames = 0;
+	gaps = 0;
+	resetClock();
+	setTimer(scanTick, TICK);
+
+	// the background loop
+	Upload result = {0, 0, 0, 0, 0};
+
+	while (!done) {
+		unsigned long start = micros();
+		output.drain(context.hits, context.scanner->getTime());
+
+		if (context.monitor->transmit(budget) == budget) {
+			// nothing to send, the loop itself takes a little time
+			advanceClock(1);
+
+		} else if (micros() - start > result.longestPass) {
+			result.longestPass = micros() - start;
+		}
+	}
+
+	setTimer(nullptr, 0);
+	usbMIDI.linkRate = 0;
+
+	result.overruns = context.scanner->getOverruns();
+	result.latency = output.getLatency();
+
+	for (auto& msg : usbMIDI.sysex) {
+		result.sessions += msg[2] == MIDI_MONITOR_END;
+	}
+
+	for (auto& event : usbMIDI.events) {
+		result.notes += event.type == MIDI_NOTE_ON;
+	}
+
+	delete context.hits;
+	delete context.monitor;
+	delete context.kit;
+	delete context.scanner;
+	return result;
+}
+
+
+//
+//	Uploads in passes of SYSEX_BUDGET don't cost a scan tick and don't hold
+//	up hits for more than a tick, a whole session in one pass would
+//
+
+TEST(uploadTicks) {
+	Upload bounded = upload(SYSEX_BUDGET);
+
+	// no tick is skipped or overrun while sessions are sent
+	CHECK(ticks == 1000ul * MS);
+	CHECK(frames == ticks);
+	CHECK(gaps == 0);
+	CHECK(bounded.overruns == 0);
+	CHECK(bounded.sessions >= 5);
+
+	// a pass fits in a tick, so hits wait at most for the pass after their frame
+	CHECK(bounded.longestPass <= (unsigned long) TICK);
+	CHECK(bounded.latency <= 2);
+
+	// the same hits are found when a session goes out in one pass, but some
+	// of them wait for it
+	Upload whole = upload(INT_MAX);
+	CHECK(whole.notes == bounded.notes);
+	CHECK(whole.longestPass > 10ul * TICK);
+	CHECK(whole.latency > 2);
+	CHECK(frames == ticks && gaps == 0 && whole.overruns == 0);
+}
@@ -0,0 +1,117 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <usb_midi.h>
+
+#include "curve.h"
+#include "pad.h"
+#include "properties.h"
+#include "test.h"
+
+
+//
+//	Velocity as sent before the maps (peaks at or below the threshold
+//	weren't sent, a sensitivity at or below the threshold divided by zero)
+//
+
+static int formula(Curve& curve, int threshold, int sensitivity, int peak) {
+	if (peak <= threshold) {
+		return 0;
+
+	} else if (sensitivity <= threshold) {
+		return curve.apply(127);
+	}
+
+	int velocity = peak > sensitivity ? sensitivity : peak;
+	velocity = ((velocity - threshold) * 127) / (sensitivity - threshold);
+	return curve.apply(velocity);
+}
+
+
+//
+//	The maps hold the same velocities for every setting and peak
+//
+
+TEST(velocityMap) {
+	Pad pad(1);
+	Properties properties;
+	properties.loadSettings(0);
+	int mismatches = 0;
+
+	for (auto c = 0; c < CURVE_COUNT; c++) {
+		Curve curve(c);
+		properties.curve = c;
+
+		for (auto threshold = 0; threshold < 128; threshold++) {
+			for (auto sensitivity = 0; sensitivity < 256; sensitivity++) {
+				// head and rim get mirrored settings so both maps are covered
+				properties.headThreshold = threshold;
+				properties.headSensitivity = sensitivity;
+				properties.rimThreshold = 127 - threshold;
+				properties.rimSensitivity = 255 - sensitivity;
+				properties.saveSettings(0);
+				pad.loadSettings(0);
+
+				for (auto peak = 0; peak < 1024; peak++) {
+					mismatches += pad.getVelocity(peak, false) != formula(curve, threshold, sensitivity, peak);
+					mismatches += pad.getVelocity(peak, true) != formula(curve, 127 - threshold, 255 - sensitivity, peak);
+				}
+			}
+		}
+	}
+
+	CHECK(mismatches == 0);
+}
+
+
+//
+//	A pad update received over midi is prepared next to the active maps and
+//	only used once detection switches to it
+//
+
+TEST(velocityUpdate) {
+	Pad pad(1);
+	Properties properties;
+	properties.loadSettings(0);
+	properties.curve = 0;
+	properties.headThreshold = 10;
+	properties.headSensitivity = 200;
+	properties.saveSettings(0);
+	pad.loadSettings(0);
+
+	// send the same settings back with a different head threshold and sensitivity
+	usbMIDI.sysex.clear();
+	properties.headThreshold = 50;
+	properties.headSensitivity = 100;
+	properties.sendAsMidi(MIDI_UPDATE_PAD, 1);
+
+	if (CHECK(usbMIDI.sysex.size() == 1)) {
+		std::vector<uint8_t> msg = usbMIDI.sysex[0];
+		CHECK(pad.receiveFromMidi(msg.data(), msg.size()));
+
+		Curve curve(0);
+		int before = 0;
+		int after = 0;
+
+		for (auto peak = 0; peak < 1024; peak++) {
+			before += pad.getVelocity(peak, false) != formula(curve, 10, 200, peak);
+		}
+
+		pad.update();
+
+		for (auto peak = 0; peak < 1024; peak++) {
+			after += pad.getVelocity(peak, false) != formula(curve, 50, 100, peak);
+		}
+
+		CHECK(before == 0);
+		CHECK(after == 0);
+	}
+}
@@ -0,0 +1,128 @@
+//	eDrum4u
+//	Copyright (c) 2021-2022 Johan A. Goossens. All rights reserved.
+//
+//	This work is licensed under the terms of the MIT license.
+//	For a copy, see <https://opensource.org/licenses/MIT>.
+
+
+//
+//	Include files
+//
+
+#include <math.h>
+
+#include "player.h"
+#include "scheduler.h"
+#include "test.h"
+
+
+//
+//	Strikes on pad 1 (sensor 1), STRIKE_INTERVAL ticks apart
+//
+
+static const int STRIKES = 30;
+static const int STRIKE_INTERVAL = 2000;
+static const int FRAMES = (STRIKES + 1) * STRIKE_INTERVAL;
+
+static void makeStrikes(Replay& replay) {
+	int values[NUMBER_OF_SENSORS] = {0};
+
+	for (auto i = 0; i < FRAMES; i++) {
+		int k = i / STRIKE_INTERVAL;
+		int t = i % STRIKE_INTERVAL;
+		double amplitude = k && t < 800 ? 100 + (k * 37) % 380 : 0;
+		values[0] = (int) (amplitude * exp(-t / 120.0) * sin(2 * M_PI * 250 * t / SAMPLING_RATE));
+		replay.addFrame(values, NUMBER_OF_SENSORS);
+	}
+}
+
+
+//
+//	Play the strikes with pad 1 set to a gate of 20ms
+//
+
+static std::vector<MidiEvent> play(unsigned long base) {
+	resetPads();
+	Properties properties = getPad(1);
+	properties.gateTime = 20;
+	setPad(1, properties);
+
+	Replay replay;
+	makeStrikes(replay);
+	return play(replay, base);
+}
+
+
+//
+//	Compare what was sent
+//
+
+static bool same(const std::vector<MidiEvent>& a, const std::vector<MidiEvent>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].time != b[i].time || a[i].type != b[i].type || a[i].data1 != b[i].data1 || a[i].data2 != b[i].data2) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+//
+//	Hits, scan, mask and retrigger timing and note offs come out the same
+//	when the sample tick counter wraps in the middle of a hit
+//
+
+TEST(clockWrap) {
+	std::vector<MidiEvent> reference = play(0);
+
+	// every strike is a note on with a note off 20ms later
+	int notes = 0;
+
+	for (auto& event : reference) {
+		notes += event.type == MIDI_NOTE_ON;
+	}
+
+	CHECK(notes == STRIKES);
+
+	// wrap during the scan time of strike 15 and during its gate
+	unsigned long strike = 15 * STRIKE_INTERVAL;
+	CHECK(same(play(0ul - strike - 5), reference));
+	CHECK(same(play(0ul - strike - 200), reference));
+}
+
+
+//
+//	Note offs scheduled before the wrap come out after it
+//
+
+TEST(schedulerWrap) {
+	Scheduler scheduler;
+	uint8_t note;
+	unsigned long start = 0ul - 1000;
+
+	for (unsigned long now = start - 5000; now != start; now++) {
+		CHECK(!scheduler.next(now, note));
+	}
+
+	CHECK(scheduler.schedule(start + 500, 40));
+	CHECK(scheduler.schedule(start + 1500, 41));
+	CHECK(scheduler.schedule(start + 5100, 42));
+
+	int sent[3] = {0};
+
+	for (unsigned long now = start; now != start + 10000; now++) {
+		while (scheduler.next(now, note)) {
+			CHECK(note >= 40 && note <= 42);
+			sent[note - 40] = (int) (now - start);
+		}
+	}
+
+	CHECK(sent[0] == 500);
+	CHECK(sent[1] == 1500);
+	CHECK(sent[2] == 5100);
+}